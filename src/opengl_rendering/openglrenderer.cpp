@@ -1,20 +1,20 @@
 #include "openglrenderer.hpp"
 
+#include <pipeline/overlay_footprint.hpp>
+#include <segmentation/mask_packing.hpp>
 #include <utils/utils.hpp>
 
 /* #include <opencv2/calib3d.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp> */
 
+#include <array>
+#include <cfloat>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 namespace fs = std::filesystem;
 
-namespace global {
-    extern HackyData hackyData; // hacky
-    extern SharedShotData filtered_shot_data;
-} // namespace global
-
 OpenGLRenderer::OpenGLRenderer(const StreamerConfiguration& config) : Magnum::Platform::WindowlessApplication({mock_main_arguments::argc, mock_main_arguments::argv}, Magnum::NoCreate), _opengl_valid(false)
 {
     _gpu_id = config.gpu_id;
@@ -28,6 +28,33 @@ OpenGLRenderer::OpenGLRenderer(const StreamerConfiguration& config) : Magnum::Pl
     red_x_url = config.red_x_url;
     black_dot_url = config.black_dot_url;
 
+    // GPU segmentation: same model parameters and clean-up chain as on the CPU (see FusedMaskFilter)
+    _gpu_segmentation = config.gpu_segmentation;
+    _gpu_luma_input = (config.pixel_format == "i420");
+    _model_history = std::max<std::size_t>(1, config.bg_sub_history);
+    _model_var_threshold = static_cast<float>(config.distance_threshold);
+    _model_detect_shadows = config.detect_shadows;
+    auto add_mask_step = [&](Magnum::MaskMorphologyShader::Operation operation, int radius) {
+        if (radius <= 0)
+            return;
+        if (radius > Magnum::MaskMorphologyShader::max_radius) {
+            std::cerr << "GPU mask clean-up supports kernels up to " << 2 * Magnum::MaskMorphologyShader::max_radius + 1 << " pixels. Clamping." << std::endl;
+            radius = Magnum::MaskMorphologyShader::max_radius;
+        }
+        _mask_steps.emplace_back(operation, radius);
+    };
+    add_mask_step(Magnum::MaskMorphologyShader::Operation::Majority, config.mask_median_size / 2);
+    add_mask_step(Magnum::MaskMorphologyShader::Operation::Min, config.mask_erode_size / 2);
+    add_mask_step(Magnum::MaskMorphologyShader::Operation::Max, (config.mask_dilate_size / 2) * std::max(0, config.mask_dilate_iterations));
+    add_mask_step(Magnum::MaskMorphologyShader::Operation::Min, config.mask_close_erode_size / 2);
+
+    // Overlay footprint: empty until overlays are built, unless the whole ROI is always processed
+    _footprint_only = config.footprint_only;
+    _transfer_depth = std::max<std::size_t>(1, config.transfer_depth);
+    if (!_footprint_only)
+        _footprint.assign(1, cv::Rect(0, 0, _rendering_ROI.width, _rendering_ROI.height));
+    _segmentation_rects = _footprint;
+
     // Tab configurations
     background_template = read_image("tab/transparent_background.png", true);
     orange_bar = read_image("tab/orange_bar.png", true);
@@ -433,13 +460,13 @@ ShotChartData OpenGLRenderer::_read_shot_data(const ShotDataEntry& data)
     }
 
     // Positioning shots on selected side of the court
-    if ((global::hackyData.side == 0 && x > 14.) || (global::hackyData.side == 1 && x < 14.)) {
+    if ((_display.side == 0 && x > 14.) || (_display.side == 1 && x < 14.)) {
         x = 28. - x;
         y = 15. - y;
     }
 
     // Getting the region of the shot
-   /*  if (global::hackyData.side == 0) {
+   /*  if (_display.side == 0) {
         if ((x >= 0) && (x <= 5.79) && (y >= 5.1) && (y <= 9.9)) {
             shot.region = 1;
         }
@@ -696,7 +723,7 @@ void OpenGLRenderer::print_tab(const ShotData& data)
     double qx = 2., qy = 1.2, qz = 0.8; // Best translation and orientation i could get
     double sx = 3., sy = 3., sz = 1.;
 
-    if (global::hackyData.side == 1) {
+    if (_display.side == 1) {
         x = 30.2;
         qy = -1.2;
         qz = -0.8;
@@ -717,7 +744,7 @@ void OpenGLRenderer::print_tab(const ShotData& data)
             cv::cvtColor(tab_background, tab_background, cv::COLOR_GRAY2BGRA);
         }
 
-        if (global::hackyData.player == 0) {
+        if (_display.player == 0) {
             if (data[0].teamId == "A") {
                 tab_logo = tab_logos.teamA;
                 tab_name = "Team Stats";
@@ -727,7 +754,7 @@ void OpenGLRenderer::print_tab(const ShotData& data)
                 tab_name = "Team Stats";
             }
         }
-        else if (global::hackyData.player == 1) {
+        else if (_display.player == 1) {
             if (data[0].teamId == "A") {
                 tab_logo = tab_logos.teamA_player[0];
                 tab_name = tab_names[2];
@@ -761,54 +788,54 @@ void OpenGLRenderer::print_tab(const ShotData& data)
         resized_logo.copyTo(tab_background(logo_roi), logo_alpha);
 
         // Print name
-        if (global::hackyData.player == 0) {
+        if (_display.player == 0) {
             _font0->putText(tab_background, tab_name, namePointTeam, tabFontHeightName, cv::Scalar(0, 0, 0), -1, cv::LINE_AA, false);
         }
         else
             _font0->putText(tab_background, tab_name, namePoint, tabFontHeightName, cv::Scalar(0, 0, 0), -1, cv::LINE_AA, false);
 
         // Get stats
-        for (size_t i = 0; i < global::filtered_shot_data.shot_data.size(); i++) {
-            if ((global::filtered_shot_data.shot_data[i].shotType.compare("2p") == 0) && (global::filtered_shot_data.shot_data[i].made == 1)) {
+        for (size_t i = 0; i < data.size(); i++) {
+            if ((data[i].shotType.compare("2p") == 0) && (data[i].made == 1)) {
                 stats.made2p++;
                 stats.total2p++;
             }
-            else if ((global::filtered_shot_data.shot_data[i].shotType.compare("2p") == 0) && (global::filtered_shot_data.shot_data[i].made == 0)) {
+            else if ((data[i].shotType.compare("2p") == 0) && (data[i].made == 0)) {
                 stats.total2p++;
             }
-            else if ((global::filtered_shot_data.shot_data[i].shotType.compare("3p") == 0) && (global::filtered_shot_data.shot_data[i].made == 1)) {
+            else if ((data[i].shotType.compare("3p") == 0) && (data[i].made == 1)) {
                 stats.made3p++;
                 stats.total3p++;
             }
-            else if ((global::filtered_shot_data.shot_data[i].shotType.compare("3p") == 0) && (global::filtered_shot_data.shot_data[i].made == 0)) {
+            else if ((data[i].shotType.compare("3p") == 0) && (data[i].made == 0)) {
                 stats.total3p++;
             }
         }
 
         // Print 2p stats
-        if ((global::hackyData.shotType == 2) || global::hackyData.shotType == 0) {
+        if ((_display.shotType == 2) || _display.shotType == 0) {
             double percentage_2p = (stats.made2p / stats.total2p) * 100;
             char formated_percentage_2p[5];
             std::sprintf(formated_percentage_2p, "%.1lf", percentage_2p);
             std::string label_2p = "2FG: " + std::to_string(static_cast<int>(stats.made2p)) + "/" + std::to_string(static_cast<int>(stats.total2p)) + " " + formated_percentage_2p + "%";
-            if (global::hackyData.shotType == 0) {
+            if (_display.shotType == 0) {
                 _font1->putText(tab_background, label_2p, point_2p, tabFontHeightStats, cv::Scalar(0, 0, 0), -1, cv::LINE_AA, false);
             }
-            else if (global::hackyData.shotType == 2) {
+            else if (_display.shotType == 2) {
                 _font1->putText(tab_background, label_2p, point_middle, tabFontHeightStats, cv::Scalar(0, 0, 0), -1, cv::LINE_AA, false);
             }
         }
 
         // Print 3p stats
-        if ((global::hackyData.shotType == 3) || global::hackyData.shotType == 0) {
+        if ((_display.shotType == 3) || _display.shotType == 0) {
             double percentage_3p = (stats.made3p / stats.total3p) * 100;
             char formated_percentage_3p[5];
             std::sprintf(formated_percentage_3p, "%.1lf", percentage_3p);
             std::string label_3p = "3FG: " + std::to_string(static_cast<int>(stats.made3p)) + "/" + std::to_string(static_cast<int>(stats.total3p)) + " " + formated_percentage_3p + "%";
-            if (global::hackyData.shotType == 0) {
+            if (_display.shotType == 0) {
                 _font1->putText(tab_background, label_3p, point_3p, tabFontHeightStats, cv::Scalar(0, 0, 0), -1, cv::LINE_AA, false);
             }
-            else if (global::hackyData.shotType == 3) {
+            else if (_display.shotType == 3) {
                 _font1->putText(tab_background, label_3p, point_middle, tabFontHeightStats, cv::Scalar(0, 0, 0), -1, cv::LINE_AA, false);
             }
         }
@@ -851,10 +878,10 @@ void OpenGLRenderer::print_tab(const ShotData& data)
 void OpenGLRenderer::print_logo_middle()
 {
     cv::Mat logo;
-    if (global::hackyData.team == 1) {
+    if (_display.team == 1) {
         logo = tab_logos.teamA;
     }
-    else if (global::hackyData.team == 2) {
+    else if (_display.team == 2) {
         logo = tab_logos.teamB;
     }
 
@@ -918,11 +945,11 @@ void OpenGLRenderer::print_stats_on_court(const ShotData& data)
     double qx = 0., qy = 0., qz = 0.;
     double sx = 4.487, sy = 3.5, sz = 1.; // Scaling with correct aspect ratio!
 
-    if (global::hackyData.side == 0) { // Left Court
+    if (_display.side == 0) { // Left Court
         x = 11.72;
         y = 1.58;
     }
-    else if (global::hackyData.side == 1) { // Right Court
+    else if (_display.side == 1) { // Right Court
         x = 16.3;
         y = 1.6;
     }
@@ -935,7 +962,7 @@ void OpenGLRenderer::print_stats_on_court(const ShotData& data)
 
     if (!background.empty()) {
 
-        switch (global::hackyData.timePeriod) { // Setting up time-period label
+        switch (_display.timePeriod) { // Setting up time-period label
         case 1:
             time_period = "1st Quarter";
             break;
@@ -957,7 +984,7 @@ void OpenGLRenderer::print_stats_on_court(const ShotData& data)
         }
 
         // Getting Team/Player name and logo
-        if (global::hackyData.player == 0) {
+        if (_display.player == 0) {
             if (data[0].teamId == "A") {
                 team_logo = tab_logos.teamA;
                 tab_name = tab_names[0];
@@ -969,29 +996,29 @@ void OpenGLRenderer::print_stats_on_court(const ShotData& data)
         }
         else if (data[0].teamId == "A") {
             team_logo = tab_logos.teamA;
-            tab_name = tab_names[global::hackyData.player + 1] + " #" + std::to_string(global::hackyData.player);
-            if (!tab_logos.teamA_player[global::hackyData.player - 1].empty()) {
-                player_logo = tab_logos.teamA_player[global::hackyData.player - 1];
+            tab_name = tab_names[_display.player + 1] + " #" + std::to_string(_display.player);
+            if (!tab_logos.teamA_player[_display.player - 1].empty()) {
+                player_logo = tab_logos.teamA_player[_display.player - 1];
             }
         }
         else if (data[0].teamId == "B") {
             team_logo = tab_logos.teamB;
-            tab_name = tab_names[global::hackyData.player + 13] + " #" + std::to_string(global::hackyData.player);
-            if (!tab_logos.teamB_player[global::hackyData.player - 1].empty()) {
-                player_logo = tab_logos.teamB_player[global::hackyData.player - 1];
+            tab_name = tab_names[_display.player + 13] + " #" + std::to_string(_display.player);
+            if (!tab_logos.teamB_player[_display.player - 1].empty()) {
+                player_logo = tab_logos.teamB_player[_display.player - 1];
             }
         }
 
         // Formatting the name label
         std::size_t spacePos, numPos;
-        if (global::hackyData.player != 0) {
+        if (_display.player != 0) {
             spacePos = tab_name.find(" ");
             numPos = tab_name.find("#");
             tab_name = tab_name.substr(spacePos + 1, numPos - 2 - spacePos + 1) + " " + tab_name.substr(0, 1) + ". " + tab_name.substr(numPos, std::string::npos);
         }
 
         // Placing Player and Team logo
-        if ((global::hackyData.player != 0) && (!player_logo.empty())) {
+        if ((_display.player != 0) && (!player_logo.empty())) {
             place_image_into_ROI(team_logo, background, background_logo_roi, cv::Mat(), "center", "center", false, 1.0);
             cv::Rect player_roi = calculate_fit_ROI(player_logo, front_logo_roi, "center", "center");
             cv::Mat tmp_img, tmp_img_alpha;
@@ -1014,7 +1041,7 @@ void OpenGLRenderer::print_stats_on_court(const ShotData& data)
         }
 
         // Placing the Stats bar depending on what stats are being shown (2p/3p/both)
-        if ((global::hackyData.shotType == 2) || (global::hackyData.shotType == 3)) {
+        if ((_display.shotType == 2) || (_display.shotType == 3)) {
             cv::Mat dst = background(middle_bar_roi);
             overlay_image(orange_bar, dst, orange_bar_alpha, false, 1.);
             background_alpha(middle_bar_roi) = cv::max(background_alpha(middle_bar_roi), orange_bar_alpha);
@@ -1039,28 +1066,28 @@ void OpenGLRenderer::print_stats_on_court(const ShotData& data)
         draw_text(background, time_period, periodPoint, periodMaxWidth, _font0, fontHeightTime, cv::Scalar(255, 255, 255));
 
         // Print 2p stats
-        if ((global::hackyData.shotType == 2) || (global::hackyData.shotType == 0)) {
-            global::filtered_shot_data.stats.percentage_2p = (global::filtered_shot_data.stats.made2p / global::filtered_shot_data.stats.total2p) * 100;
-            std::sprintf(global::filtered_shot_data.stats.formated_percentage_2p, "%.1lf", global::filtered_shot_data.stats.percentage_2p);
-            global::filtered_shot_data.stats.label_2p = "2FG  " + std::string(global::filtered_shot_data.stats.formated_percentage_2p) + "%";
-            if (global::hackyData.shotType == 2) {
-                draw_text(background, global::filtered_shot_data.stats.label_2p, point_middle, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
+        if ((_display.shotType == 2) || (_display.shotType == 0)) {
+            _court_stats.percentage_2p = (_court_stats.made2p / _court_stats.total2p) * 100;
+            std::sprintf(_court_stats.formated_percentage_2p, "%.1lf", _court_stats.percentage_2p);
+            _court_stats.label_2p = "2FG  " + std::string(_court_stats.formated_percentage_2p) + "%";
+            if (_display.shotType == 2) {
+                draw_text(background, _court_stats.label_2p, point_middle, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
             }
             else {
-                draw_text(background, global::filtered_shot_data.stats.label_2p, point_2p, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
+                draw_text(background, _court_stats.label_2p, point_2p, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
             }
         }
 
         // Print 3p stats
-        if ((global::hackyData.shotType == 3) || (global::hackyData.shotType == 0)) {
-            global::filtered_shot_data.stats.percentage_3p = (global::filtered_shot_data.stats.made3p / global::filtered_shot_data.stats.total3p) * 100;
-            std::sprintf(global::filtered_shot_data.stats.formated_percentage_3p, "%.1lf", global::filtered_shot_data.stats.percentage_3p);
-            global::filtered_shot_data.stats.label_3p = "3FG  " + std::string(global::filtered_shot_data.stats.formated_percentage_3p) + "%";
-            if (global::hackyData.shotType == 3) {
-                draw_text(background, global::filtered_shot_data.stats.label_3p, point_middle, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
+        if ((_display.shotType == 3) || (_display.shotType == 0)) {
+            _court_stats.percentage_3p = (_court_stats.made3p / _court_stats.total3p) * 100;
+            std::sprintf(_court_stats.formated_percentage_3p, "%.1lf", _court_stats.percentage_3p);
+            _court_stats.label_3p = "3FG  " + std::string(_court_stats.formated_percentage_3p) + "%";
+            if (_display.shotType == 3) {
+                draw_text(background, _court_stats.label_3p, point_middle, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
             }
             else {
-                draw_text(background, global::filtered_shot_data.stats.label_3p, point_3p, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
+                draw_text(background, _court_stats.label_3p, point_3p, pointsMaxWidth, _font1, fontHeightStats, cv::Scalar(255, 255, 255));
             }
         }
 
@@ -1241,28 +1268,28 @@ void OpenGLRenderer::print_regions() {
     double qx = 0., qy = 0., qz = 0.; 
     double sx = 12.1, sy = 14.85, sz = 1.;
 
-    if (global::hackyData.side == 0) { // Left Court
+    if (_display.side == 0) { // Left Court
         x = 5.7;
         y = 7.1;
     }
-    else if (global::hackyData.side == 1) { // Right Court
+    else if (_display.side == 1) { // Right Court
         x = 22.3;
         y = 7.1;
     }
 
     // Varied point to print stats depending on the side of the court
-    region1Point = cv::Point((global::hackyData.side * 1400) + 260 - (2 * global::hackyData.side * 260) - (global::hackyData.side * 100), 1185);
-    region2Point = cv::Point((global::hackyData.side * 1400) + 260 - (2 * global::hackyData.side * 260) - (global::hackyData.side * 100), 700);
-    region3Point = cv::Point((global::hackyData.side * 1400) + 260 - (2 * global::hackyData.side * 260) - (global::hackyData.side * 100), 255);
-    region4Point = cv::Point((global::hackyData.side * 1400) + 710 - (2 * global::hackyData.side * 710) - (global::hackyData.side * 180), 700);
-    region5Point = cv::Point((global::hackyData.side * 1400) + 1020 - (2 * global::hackyData.side * 1020) - (global::hackyData.side * 125), 1185);
-    region6Point = cv::Point((global::hackyData.side * 1400) + 1020 - (2 * global::hackyData.side * 1020) - (global::hackyData.side * 180), 700);
-    region7Point = cv::Point((global::hackyData.side * 1400) + 1020 - (2 * global::hackyData.side * 1020) - (global::hackyData.side * 125), 255);
-    region8Point = cv::Point((global::hackyData.side * 1400) + 130 - (2 * global::hackyData.side * 130) - (global::hackyData.side * 100), 1435);
-    region9Point = cv::Point((global::hackyData.side * 1400) + 130 - (2 * global::hackyData.side * 130) - (global::hackyData.side * 100), 20);
-
-
-    if (global::hackyData.side == 0) {
+    region1Point = cv::Point((_display.side * 1400) + 260 - (2 * _display.side * 260) - (_display.side * 100), 1185);
+    region2Point = cv::Point((_display.side * 1400) + 260 - (2 * _display.side * 260) - (_display.side * 100), 700);
+    region3Point = cv::Point((_display.side * 1400) + 260 - (2 * _display.side * 260) - (_display.side * 100), 255);
+    region4Point = cv::Point((_display.side * 1400) + 710 - (2 * _display.side * 710) - (_display.side * 180), 700);
+    region5Point = cv::Point((_display.side * 1400) + 1020 - (2 * _display.side * 1020) - (_display.side * 125), 1185);
+    region6Point = cv::Point((_display.side * 1400) + 1020 - (2 * _display.side * 1020) - (_display.side * 180), 700);
+    region7Point = cv::Point((_display.side * 1400) + 1020 - (2 * _display.side * 1020) - (_display.side * 125), 255);
+    region8Point = cv::Point((_display.side * 1400) + 130 - (2 * _display.side * 130) - (_display.side * 100), 1435);
+    region9Point = cv::Point((_display.side * 1400) + 130 - (2 * _display.side * 130) - (_display.side * 100), 20);
+
+
+    if (_display.side == 0) {
         switch (hotzone)
         {
         case 1:
@@ -1298,7 +1325,7 @@ void OpenGLRenderer::print_regions() {
             std::cout << "\nERROR: No Hotzone\n";
             break;
         }
-    } else if (global::hackyData.side == 1) {
+    } else if (_display.side == 1) {
         switch (hotzone)
         {
         case 1:
@@ -1425,8 +1452,11 @@ void OpenGLRenderer::opengl_init(const StreamerConfiguration& config)
             }
         }
 
-        _combine_mask_shader.reset(new Magnum::CombineMaskShader);
+        // Masks from the CPU arrive bit-packed, GPU masks stay R8
+        _combine_mask_shader.reset(new Magnum::CombineMaskShader(!_gpu_segmentation));
+        _combine_mask_yuv_shader.reset(new Magnum::CombineMaskYUVShader(!_gpu_segmentation));
         _textured_quad_shader.reset(new Magnum::TexturedQuadShader);
+        _shot_instance_shader.reset(new Magnum::ShotInstanceShader);
 
         _frame_texture.reset(new Magnum::GL::Texture2D);
         _mask_texture.reset(new Magnum::GL::Texture2D);
@@ -1437,90 +1467,121 @@ void OpenGLRenderer::opengl_init(const StreamerConfiguration& config)
             .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
             .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {static_cast<int>(_rendering_ROI.width), static_cast<int>(_rendering_ROI.height)});
 
-        _mask_texture->setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
-            .setMinificationFilter(Magnum::GL::SamplerFilter::Linear)
-            .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
-            .setStorage(1, Magnum::GL::TextureFormat::R8, {static_cast<int>(_rendering_ROI.width), static_cast<int>(_rendering_ROI.height)});
-
-        // Shot textures
-        cv::Mat made_shot_img = cv::imread(config.green_circle_url, cv::IMREAD_UNCHANGED);
-        cv::Mat missed_shot_img = cv::imread(config.red_x_url, cv::IMREAD_UNCHANGED);
-        cv::Mat black_dot_img = cv::imread(config.black_dot_url, cv::IMREAD_UNCHANGED);
-
-        if (!made_shot_img.empty()) {
-            // Check if shot has an alpha channel
-            if (made_shot_img.channels() == 3) {
-                cv::cvtColor(made_shot_img, made_shot_img, cv::COLOR_BGR2BGRA);
-            }
-            else if (made_shot_img.channels() == 1) {
-                cv::cvtColor(made_shot_img, made_shot_img, cv::COLOR_GRAY2BGRA);
-            }
-            cv::flip(made_shot_img, made_shot_img, 0);
-
-            _shot_textures.emplace_back(new Magnum::GL::Texture2D);
-            (*_shot_textures[0])
-                .setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
+        if (_gpu_segmentation) {
+            _mask_texture->setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
                 .setMinificationFilter(Magnum::GL::SamplerFilter::Linear)
                 .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
-                .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {made_shot_img.size().width, made_shot_img.size().height})
-                .setSubImage(0, {}, Magnum::ImageView2D{Magnum::PixelStorage{}.setAlignment(1), Magnum::PixelFormat::RGBA8Unorm, {made_shot_img.size().width, made_shot_img.size().height}, Magnum::Containers::ArrayView<unsigned char>{made_shot_img.data, made_shot_img.size().width * made_shot_img.size().height * made_shot_img.elemSize()}});
+                .setStorage(1, Magnum::GL::TextureFormat::R8, {static_cast<int>(_rendering_ROI.width), static_cast<int>(_rendering_ROI.height)});
         }
-        else
-            std::cout << "Could not load shot image: " + config.green_circle_url << std::endl;
-
-        if (!missed_shot_img.empty()) {
-            // Check if shot has an alpha channel
-            if (missed_shot_img.channels() == 3) {
-                cv::cvtColor(missed_shot_img, missed_shot_img, cv::COLOR_BGR2BGRA);
-            }
-            else if (missed_shot_img.channels() == 1) {
-                cv::cvtColor(missed_shot_img, missed_shot_img, cv::COLOR_GRAY2BGRA);
-            }
-            cv::flip(missed_shot_img, missed_shot_img, 0);
-
-            _shot_textures.emplace_back(new Magnum::GL::Texture2D);
-            (*_shot_textures[1])
-                .setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
-                .setMinificationFilter(Magnum::GL::SamplerFilter::Linear)
+        else {
+            // 32 mask pixels per texel (see pack_mask), read with imageLoad only
+            _mask_texture->setMagnificationFilter(Magnum::GL::SamplerFilter::Nearest)
+                .setMinificationFilter(Magnum::GL::SamplerFilter::Nearest)
                 .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
-                .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {missed_shot_img.size().width, missed_shot_img.size().height})
-                .setSubImage(0, {}, Magnum::ImageView2D{Magnum::PixelStorage{}.setAlignment(1), Magnum::PixelFormat::RGBA8Unorm, {missed_shot_img.size().width, missed_shot_img.size().height}, Magnum::Containers::ArrayView<unsigned char>{missed_shot_img.data, missed_shot_img.size().width * missed_shot_img.size().height * missed_shot_img.elemSize()}});
+                .setStorage(1, Magnum::GL::TextureFormat::R32UI, {packed_mask_words(_rendering_ROI.width), static_cast<int>(_rendering_ROI.height)});
         }
-        else
-            std::cout << "Could not load shot image: " + config.red_x_url << std::endl;
 
-        if (!black_dot_img.empty()) {
-            // Check if shot has an alpha channel
-            if (black_dot_img.channels() == 3) {
-                cv::cvtColor(black_dot_img, black_dot_img, cv::COLOR_BGR2BGRA);
-            }
-            else if (black_dot_img.channels() == 1) {
-                cv::cvtColor(black_dot_img, black_dot_img, cv::COLOR_GRAY2BGRA);
+        // Renderers compositing with a shared mask never run the model, only its owner gets the model and the clean-up
+        if (_gpu_segmentation && _mask_source == nullptr) {
+            _gaussian_mixture_shader.reset(new Magnum::GaussianMixtureShader(_gpu_luma_input));
+            _mask_morphology_shader.reset(new Magnum::MaskMorphologyShader);
+            // Zeroed model: no components yet, the first frame initializes every pixel
+            std::size_t model_bytes = std::size_t(_rendering_ROI.width) * _rendering_ROI.height * Magnum::GaussianMixtureShader::model_size();
+            _model_buffer.reset(new Magnum::GL::Buffer);
+            Corrade::Containers::Array<char> zeros{Corrade::ValueInit, model_bytes};
+            _model_buffer->setData(zeros, Magnum::GL::BufferUsage::DynamicCopy);
+            _model_frames = 0;
+            _mask_scratch_texture.reset(new Magnum::GL::Texture2D);
+            _mask_scratch_texture->setStorage(1, Magnum::GL::TextureFormat::R8, {static_cast<int>(_rendering_ROI.width), static_cast<int>(_rendering_ROI.height)});
+        }
+
+        // Planes of the ROI for I420 frames (see render_i420)
+        _luma_texture.reset(new Magnum::GL::Texture2D);
+        _chroma_u_texture.reset(new Magnum::GL::Texture2D);
+        _chroma_v_texture.reset(new Magnum::GL::Texture2D);
+        _luma_texture->setStorage(1, Magnum::GL::TextureFormat::R8, {static_cast<int>(_rendering_ROI.width), static_cast<int>(_rendering_ROI.height)});
+        _chroma_u_texture->setStorage(1, Magnum::GL::TextureFormat::R8, {static_cast<int>(_rendering_ROI.width) / 2, static_cast<int>(_rendering_ROI.height) / 2});
+        _chroma_v_texture->setStorage(1, Magnum::GL::TextureFormat::R8, {static_cast<int>(_rendering_ROI.width) / 2, static_cast<int>(_rendering_ROI.height) / 2});
+
+        // Shot icons: one texture array, layer 0 made, 1 missed, 2 black dot (see _upload_shot_instances). Layers share
+        // the size of the largest icon; the others are scaled up to it, a missing icon stays transparent.
+        {
+            std::array<std::string, 3> shot_urls{config.green_circle_url, config.red_x_url, config.black_dot_url};
+            std::array<cv::Mat, 3> shot_imgs;
+            cv::Size icon_size(1, 1);
+            for (std::size_t i = 0; i < shot_imgs.size(); i++) {
+                cv::Mat& img = shot_imgs[i];
+                img = cv::imread(shot_urls[i], cv::IMREAD_UNCHANGED);
+                if (img.empty()) {
+                    std::cout << "Could not load shot image: " + shot_urls[i] << std::endl;
+                    continue;
+                }
+                // Check if shot has an alpha channel
+                if (img.channels() == 3) {
+                    cv::cvtColor(img, img, cv::COLOR_BGR2BGRA);
+                }
+                else if (img.channels() == 1) {
+                    cv::cvtColor(img, img, cv::COLOR_GRAY2BGRA);
+                }
+                cv::flip(img, img, 0);
+                icon_size.width = std::max(icon_size.width, img.cols);
+                icon_size.height = std::max(icon_size.height, img.rows);
             }
-            cv::flip(black_dot_img, black_dot_img, 0);
 
-            _shot_textures.emplace_back(new Magnum::GL::Texture2D);
-            (*_shot_textures[2])
+            _shot_texture_array.reset(new Magnum::GL::Texture2DArray);
+            (*_shot_texture_array)
                 .setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
                 .setMinificationFilter(Magnum::GL::SamplerFilter::Linear)
                 .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
-                .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {black_dot_img.size().width, black_dot_img.size().height})
-                .setSubImage(0, {}, Magnum::ImageView2D{Magnum::PixelStorage{}.setAlignment(1), Magnum::PixelFormat::RGBA8Unorm, {black_dot_img.size().width, black_dot_img.size().height}, Magnum::Containers::ArrayView<unsigned char>{black_dot_img.data, black_dot_img.size().width * black_dot_img.size().height * black_dot_img.elemSize()}});
+                .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {icon_size.width, icon_size.height, int(shot_imgs.size())});
+            for (std::size_t i = 0; i < shot_imgs.size(); i++) {
+                cv::Mat layer = cv::Mat::zeros(icon_size, CV_8UC4);
+                if (!shot_imgs[i].empty())
+                    cv::resize(shot_imgs[i], layer, icon_size, 0., 0., cv::INTER_LINEAR);
+                _shot_texture_array->setSubImage(0, {0, 0, int(i)}, Magnum::ImageView3D{Magnum::PixelStorage{}.setAlignment(1), Magnum::PixelFormat::RGBA8Unorm, {icon_size.width, icon_size.height, 1}, Magnum::Containers::ArrayView<unsigned char>{layer.data, layer.total() * layer.elemSize()}});
+            }
         }
-        else
-            std::cout << "Could not load shot image: " + config.red_x_url << std::endl;
 
         // Prepare render texture
         _render_texture->setMagnificationFilter(Magnum::GL::SamplerFilter::Linear)
             .setMinificationFilter(Magnum::GL::SamplerFilter::Linear)
             .setWrapping(Magnum::GL::SamplerWrapping::ClampToEdge)
-            .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {static_cast<int>(_original_width), static_cast<int>(_original_height)}); // size same as input image
+            .setStorage(1, Magnum::GL::TextureFormat::RGBA8, {_rendering_ROI.width, _rendering_ROI.height}); // only the ROI is ever composited
 
         // Create FrameBuffer
-        _framebuffer.reset(new Magnum::GL::Framebuffer({{}, {static_cast<int>(_original_width), static_cast<int>(_original_height)}}));
+        _framebuffer.reset(new Magnum::GL::Framebuffer({{}, {_rendering_ROI.width, _rendering_ROI.height}}));
 
         _framebuffer->attachTexture(Magnum::GL::Framebuffer::ColorAttachment{0}, *_render_texture, 0);
         _framebuffer->mapForDraw({{0, {Magnum::GL::Framebuffer::ColorAttachment{0}}}});
+        // Fresh texture: the overlay layer is drawn (and cleared as a whole) on the first render
+        _overlay_dirty = true;
+        _layer_bounds = cv::Rect(0, 0, _rendering_ROI.width, _rendering_ROI.height);
+
+        // Transfer ring for asynchronous uploads and readbacks; a slot holds the largest layout (the RGB ROI)
+        _transfer_slots.clear();
+        _next_slot = 0;
+        _slots_in_flight = 0;
+        if (_transfer_depth > 1) {
+            _transfer_bytes = std::size_t(_rendering_ROI.width) * _rendering_ROI.height * 3;
+            _transfer_persistent = Magnum::GL::Context::current().isExtensionSupported<Magnum::GL::Extensions::ARB::buffer_storage>();
+            _transfer_slots.resize(_transfer_depth);
+            for (TransferSlot& slot : _transfer_slots) {
+                slot.upload.reset(new Magnum::GL::Buffer{Magnum::GL::Buffer::TargetHint::PixelUnpack});
+                slot.readback.reset(new Magnum::GL::Buffer{Magnum::GL::Buffer::TargetHint::PixelPack});
+                if (_transfer_persistent) {
+                    using Storage = Magnum::GL::Buffer::StorageFlag;
+                    using Map = Magnum::GL::Buffer::MapFlag;
+                    slot.upload->setStorage({nullptr, _transfer_bytes}, Storage::MapWrite | Storage::MapPersistent | Storage::MapCoherent);
+                    slot.upload_map = slot.upload->map(0, _transfer_bytes, Map::Write | Map::Persistent | Map::Coherent);
+                    slot.readback->setStorage({nullptr, _transfer_bytes}, Storage::MapRead | Storage::MapPersistent | Storage::MapCoherent);
+                    slot.readback_map = slot.readback->map(0, _transfer_bytes, Map::Read | Map::Persistent | Map::Coherent);
+                }
+                else {
+                    slot.upload->setData({nullptr, _transfer_bytes}, Magnum::GL::BufferUsage::StreamDraw);
+                    slot.readback->setData({nullptr, _transfer_bytes}, Magnum::GL::BufferUsage::StreamRead);
+                }
+            }
+        }
 
         // Create quad mesh for shot printing
         {
@@ -1541,10 +1602,23 @@ void OpenGLRenderer::opengl_init(const StreamerConfiguration& config)
                 .addVertexBuffer(std::move(buffer), 0,
                     Magnum::TexturedQuadShader::Position{},
                     Magnum::TexturedQuadShader::TextureCoordinates{});
+
+            // Same quad, drawn once per shot with the instance buffer (filled by _upload_shot_instances)
+            Magnum::GL::Buffer shot_buffer;
+            shot_buffer.setData(quad_data);
+            _shot_instance_buffer.reset(new Magnum::GL::Buffer);
+            _shot_mesh.reset(new Magnum::GL::Mesh);
+            (*_shot_mesh)
+                .setCount(6)
+                .setInstanceCount(0)
+                .addVertexBuffer(std::move(shot_buffer), 0,
+                    Magnum::ShotInstanceShader::Position{},
+                    Magnum::ShotInstanceShader::TextureCoordinates{})
+                .addVertexBufferInstanced(*_shot_instance_buffer, 1, 0, Magnum::ShotInstanceShader::InstanceData{});
         }
         // Compute Camera matrices
         {
-            auto size = _render_texture->imageSize(0);
+            Magnum::Vector2 size{static_cast<Magnum::Float>(_original_width), static_cast<Magnum::Float>(_original_height)};
             Magnum::Float near = 0.1f;
             Magnum::Float far = 300.f;
 
@@ -1572,15 +1646,23 @@ void OpenGLRenderer::opengl_init(const StreamerConfiguration& config)
             persp[3][2] = near * far;
 
             Magnum::Float left = 0.f;
-            Magnum::Float right = static_cast<Magnum::Float>(size[0]);
+            Magnum::Float right = size[0];
             Magnum::Float bottom = 0.f;
-            Magnum::Float top = static_cast<Magnum::Float>(size[1]);
+            Magnum::Float top = size[1];
             Magnum::Float tx = -(left + right) / (right - left);
             Magnum::Float ty = -(top + bottom) / (top - bottom);
-            Magnum::Matrix4 ortho = Magnum::Matrix4::orthographicProjection({static_cast<Magnum::Float>(size[0]), static_cast<Magnum::Float>(size[1])}, near, far);
+            Magnum::Matrix4 ortho = Magnum::Matrix4::orthographicProjection(size, near, far);
             ortho[3][0] = tx;
             ortho[3][1] = ty;
-            _proj_matrix = ortho * persp;
+
+            // The render target only covers the ROI: map its part of the frame (bottom-left origin) onto the whole
+            // clip space
+            Magnum::Vector2 roi_size{static_cast<Magnum::Float>(_rendering_ROI.width), static_cast<Magnum::Float>(_rendering_ROI.height)};
+            Magnum::Vector2 roi_origin{static_cast<Magnum::Float>(_rendering_ROI.x), static_cast<Magnum::Float>(static_cast<int>(_original_height) - _rendering_ROI.y - _rendering_ROI.height)};
+            Magnum::Vector2 crop_scale = size / roi_size;
+            Magnum::Vector2 crop_offset = (size - 2.f * roi_origin - roi_size) / roi_size;
+            Magnum::Matrix4 crop = Magnum::Matrix4::translation({crop_offset, 0.f}) * Magnum::Matrix4::scaling({crop_scale, 1.f});
+            _proj_matrix = crop * ortho * persp;
         }
         _opengl_valid = true;
     }
@@ -1591,197 +1673,660 @@ void OpenGLRenderer::opengl_destroy()
     if (!_opengl_valid)
         return;
 
+    // Frames still in flight are completed, the buffers and fences go with the slots
+    while (_slots_in_flight > 0)
+        finish_render();
+    _transfer_slots.clear();
+
     _combine_mask_shader.reset(nullptr);
+    _combine_mask_yuv_shader.reset(nullptr);
     _textured_quad_shader.reset(nullptr);
 
+    _gaussian_mixture_shader.reset(nullptr);
+    _mask_morphology_shader.reset(nullptr);
+    _model_buffer.reset(nullptr);
+    _mask_scratch_texture.reset(nullptr);
+    _mask_source = nullptr;
+
     _frame_texture.reset(nullptr);
     _mask_texture.reset(nullptr);
+    _luma_texture.reset(nullptr);
+    _chroma_u_texture.reset(nullptr);
+    _chroma_v_texture.reset(nullptr);
     _render_texture.reset(nullptr);
     _quad_mesh.reset(nullptr);
     for (auto& text : _logo_texture)
         text.reset(nullptr);
     _framebuffer.reset(nullptr);
-    for (auto& text : _shot_textures)
-        text.reset(nullptr);
+    _shot_texture_array.reset(nullptr);
+    _shot_mesh.reset(nullptr);
+    _shot_instance_buffer.reset(nullptr);
+    _shot_instance_shader.reset(nullptr);
     _framebuffer.reset(nullptr);
     _opengl_valid = false;
 }
 
-void OpenGLRenderer::render(cv::Mat& frame, const cv::Mat& foreground_mask, SharedShotData& shots)
+void OpenGLRenderer::_update_overlays(SharedShotData& shots)
 {
-    if (_opengl_valid) {
-        // Check if we need to update resources for rendering shots
-        shots.mutex.lock();
-        if (shots.updated.load()) {
-            _region_texture.clear();
-            _tab_texture.clear();
-            _court_texture.clear();
-            _logo_texture.clear();
-
-            update_shots(shots.shot_data);
-            if (global::hackyData.displayTab) {
-                print_tab(shots.shot_data);
-            }
-            if (global::hackyData.displayCourtStats) {
-                print_stats_on_court(shots.shot_data);
-                /* std::cout << "\nRegion 1: " << region1.made << "/" << region1.total << std::endl;
-                std::cout << "Region 2: " << region2.made << "/" << region2.total << std::endl;
-                std::cout << "Region 3: " << region3.made << "/" << region3.total << std::endl;
-                std::cout << "Region 4: " << region4.made << "/" << region4.total << std::endl;
-                std::cout << "Region 5: " << region5.made << "/" << region5.total << std::endl;
-                std::cout << "Region 6: " << region6.made << "/" << region6.total << std::endl;
-                std::cout << "Region 7: " << region7.made << "/" << region7.total << std::endl;
-                std::cout << "Region 8: " << region8.made << "/" << region8.total << std::endl;
-                std::cout << "Region 9: " << region9.made << "/" << region9.total << std::endl; */
-                
-            }
-            if (global::hackyData.displayLogoMiddle) {
-                print_logo_middle();
-            }
-            if (global::hackyData.displayRegions) {
-                //std::cout << "\nHERE1\n";
-                print_regions();
-            }
-            shots.updated.store(false);
-            global::filtered_shot_data.stats.reset();
-        }
-        shots.mutex.unlock();
-
-        if (_shots.size() > 0) {
-            // Flip image and foreground mask as OpenGL has bottom-left point as (0,0)
-            cv::Mat fr, fg_mask;
-            cv::flip(foreground_mask, fg_mask, 0);
-            frame(_rendering_ROI).copyTo(fr);
-            cv::flip(fr, fr, 0);
-
-            // This is to pass OpenCV cv::Mat to Magnum
-            auto image_view = Magnum::ImageView2D{Magnum::PixelStorage{}.setAlignment(1), Magnum::PixelFormat::RGB8Unorm, {fr.size().width, fr.size().height}, Magnum::Containers::ArrayView<unsigned char>{fr.data, fr.size().width * fr.size().height * fr.elemSize()}};
-            _frame_texture->setSubImage(0, {}, image_view);
-            _mask_texture->setSubImage(0, {}, Magnum::ImageView2D{Magnum::PixelStorage{}.setAlignment(1), Magnum::PixelFormat::R8Unorm, {fg_mask.size().width, fg_mask.size().height}, Magnum::Containers::ArrayView<unsigned char>{fg_mask.data, fg_mask.size().width * fg_mask.size().height * fg_mask.elemSize()}});
-
-            // Bind the _framebuffer
-            _framebuffer->bind();
-            // Clear _framebuffer
-            _framebuffer->clearColor(0, Magnum::Color4{0.f, 0.f, 0.f, 0.f});
-
-            Magnum::Matrix4 model_matrix;
-            Magnum::Matrix4 mat;
-
-            // Regions
-            if (_region_texture.size() > 0) {
-                for (std::size_t col = 0; col != 4; ++col)
-                    for (std::size_t row = 0; row != 4; ++row)
-                        model_matrix[col][row] = static_cast<Magnum::Float>(region_transformation.at<double>(row, col));
-                mat = _proj_matrix * _view_matrix * model_matrix;
-
-                (*_textured_quad_shader)
-                    .setTransformationMatrix(mat)
-                    .bindTexture(*_region_texture[0]);
-
-                _textured_quad_shader->draw(*_quad_mesh);
-            }
+    // Check if we need to update resources for rendering shots
+    shots.mutex.lock();
+    if (shots.updated.load()) {
+        // Display settings and stats are taken together with the shots, so each renderer follows its own SharedShotData
+        _display = shots.display;
+        _court_stats = shots.stats;
+        _region_texture.clear();
+        _tab_texture.clear();
+        _court_texture.clear();
+        _logo_texture.clear();
+
+        update_shots(shots.shot_data);
+        _upload_shot_instances();
+        if (_display.displayTab) {
+            print_tab(shots.shot_data);
+        }
+        if (_display.displayCourtStats) {
+            print_stats_on_court(shots.shot_data);
+            /* std::cout << "\nRegion 1: " << region1.made << "/" << region1.total << std::endl;
+            std::cout << "Region 2: " << region2.made << "/" << region2.total << std::endl;
+            std::cout << "Region 3: " << region3.made << "/" << region3.total << std::endl;
+            std::cout << "Region 4: " << region4.made << "/" << region4.total << std::endl;
+            std::cout << "Region 5: " << region5.made << "/" << region5.total << std::endl;
+            std::cout << "Region 6: " << region6.made << "/" << region6.total << std::endl;
+            std::cout << "Region 7: " << region7.made << "/" << region7.total << std::endl;
+            std::cout << "Region 8: " << region8.made << "/" << region8.total << std::endl;
+            std::cout << "Region 9: " << region9.made << "/" << region9.total << std::endl; */
+            
+        }
+        if (_display.displayLogoMiddle) {
+            print_logo_middle();
+        }
+        if (_display.displayRegions) {
+            //std::cout << "\nHERE1\n";
+            print_regions();
+        }
+        _update_footprint();
+        _overlay_dirty = true;
+        shots.updated.store(false);
+        shots.stats.reset();
+    }
+    shots.mutex.unlock();
+}
 
-            // Tab under basket
-            if (_tab_texture.size() > 0) {
-                for (std::size_t col = 0; col != 4; ++col)
-                    for (std::size_t row = 0; row != 4; ++row)
-                        model_matrix[col][row] = static_cast<Magnum::Float>(tab_transformation.at<double>(row, col));
-                mat = _proj_matrix * _view_matrix * model_matrix;
+void OpenGLRenderer::_upload_shot_instances()
+{
+    // Shot transformations are a translation on the court times a uniform scale (no rotation), so every shot fits in
+    // one vec4: x, y, scale and the icon layer
+    _shot_instances.clear();
+    for (const ShotChartData& shot : _shots) {
+        float layer;
+        if (shot.made == 1)
+            layer = 0.f;
+        else if (shot.made == 0)
+            layer = 1.f;
+        else if (shot.made == 2)
+            layer = 2.f;
+        else
+            continue;
+        // Shots that project outside the ROI never reach the layer
+        cv::Rect bounds;
+        if (!_quad_bounds(shot.transformation, bounds))
+            continue;
+        const cv::Mat& t = shot.transformation;
+        _shot_instances.emplace_back(static_cast<Magnum::Float>(t.at<double>(0, 3)), static_cast<Magnum::Float>(t.at<double>(1, 3)), static_cast<Magnum::Float>(t.at<double>(0, 0)), layer);
+    }
+    _shot_instance_buffer->setData(Magnum::Containers::arrayView(_shot_instances), Magnum::GL::BufferUsage::StaticDraw);
+    _shot_mesh->setInstanceCount(static_cast<Magnum::Int>(_shot_instances.size()));
+}
 
-                (*_textured_quad_shader)
-                    .setTransformationMatrix(mat)
-                    .bindTexture(*_tab_texture[0]);
+void OpenGLRenderer::_draw_overlays()
+{
+    // Bind the _framebuffer
+    _framebuffer->bind();
+
+    // Scissored to ROI rectangles (top-left origin) in the layer (bottom-left origin)
+    auto scissor = [this](const cv::Rect& rect) {
+        Magnum::GL::Renderer::setScissor({{rect.x, _rendering_ROI.height - rect.y - rect.height}, {rect.x + rect.width, _rendering_ROI.height - rect.y}});
+    };
+    Magnum::GL::Renderer::enable(Magnum::GL::Renderer::Feature::ScissorTest);
+    // Clear where the previous overlays were and where the new ones go, the rest of the layer is transparent already
+    scissor(_layer_bounds | _overlay_bounds);
+    _framebuffer->clearColor(0, Magnum::Color4{0.f, 0.f, 0.f, 0.f});
+    _layer_bounds = _overlay_bounds;
+    scissor(_overlay_bounds);
+
+    Magnum::Matrix4 model_matrix;
+    Magnum::Matrix4 mat;
+    // Quads outside the ROI are skipped
+    cv::Rect bounds;
 
-                _textured_quad_shader->draw(*_quad_mesh);
-            }
+    // Regions
+    if (_region_texture.size() > 0 && _quad_bounds(region_transformation, bounds)) {
+        for (std::size_t col = 0; col != 4; ++col)
+            for (std::size_t row = 0; row != 4; ++row)
+                model_matrix[col][row] = static_cast<Magnum::Float>(region_transformation.at<double>(row, col));
+        mat = _proj_matrix * _view_matrix * model_matrix;
 
-            // Middle_logo
-            if (_logo_texture.size() > 0) {
-                for (std::size_t col = 0; col != 4; ++col)
-                    for (std::size_t row = 0; row != 4; ++row)
-                        model_matrix[col][row] = static_cast<Magnum::Float>(logo_transformation.at<double>(row, col));
-                mat = _proj_matrix * _view_matrix * model_matrix;
+        (*_textured_quad_shader)
+            .setTransformationMatrix(mat)
+            .bindTexture(*_region_texture[0]);
 
-                (*_textured_quad_shader)
-                    .setTransformationMatrix(mat)
-                    .bindTexture(*_logo_texture[0]);
+        _textured_quad_shader->draw(*_quad_mesh);
+    }
 
-                _textured_quad_shader->draw(*_quad_mesh);
-            }
+    // Tab under basket
+    if (_tab_texture.size() > 0 && _quad_bounds(tab_transformation, bounds)) {
+        for (std::size_t col = 0; col != 4; ++col)
+            for (std::size_t row = 0; row != 4; ++row)
+                model_matrix[col][row] = static_cast<Magnum::Float>(tab_transformation.at<double>(row, col));
+        mat = _proj_matrix * _view_matrix * model_matrix;
+
+        (*_textured_quad_shader)
+            .setTransformationMatrix(mat)
+            .bindTexture(*_tab_texture[0]);
+
+        _textured_quad_shader->draw(*_quad_mesh);
+    }
+
+    // Middle_logo
+    if (_logo_texture.size() > 0 && _quad_bounds(logo_transformation, bounds)) {
+        for (std::size_t col = 0; col != 4; ++col)
+            for (std::size_t row = 0; row != 4; ++row)
+                model_matrix[col][row] = static_cast<Magnum::Float>(logo_transformation.at<double>(row, col));
+        mat = _proj_matrix * _view_matrix * model_matrix;
+
+        (*_textured_quad_shader)
+            .setTransformationMatrix(mat)
+            .bindTexture(*_logo_texture[0]);
+
+        _textured_quad_shader->draw(*_quad_mesh);
+    }
+
+    // Tab on court
+    if (_court_texture.size() > 0 && _quad_bounds(court_transformation, bounds)) {
+        for (std::size_t col = 0; col != 4; ++col)
+            for (std::size_t row = 0; row != 4; ++row)
+                model_matrix[col][row] = static_cast<Magnum::Float>(court_transformation.at<double>(row, col));
+        mat = _proj_matrix * _view_matrix * model_matrix;
+
+        (*_textured_quad_shader)
+            .setTransformationMatrix(mat)
+            .bindTexture(*_court_texture[0]);
 
-            // Tab on court
-            if (_court_texture.size() > 0) {
-                for (std::size_t col = 0; col != 4; ++col)
-                    for (std::size_t row = 0; row != 4; ++row)
-                        model_matrix[col][row] = static_cast<Magnum::Float>(court_transformation.at<double>(row, col));
-                mat = _proj_matrix * _view_matrix * model_matrix;
+        _textured_quad_shader->draw(*_quad_mesh);
+    }
+
+    // Shots, all in one instanced draw
+    if (_display.displayShots && _shot_mesh->instanceCount() > 0) {
+        (*_shot_instance_shader)
+            .setTransformationMatrix(_proj_matrix * _view_matrix)
+            .bindTexture(*_shot_texture_array);
+
+        _shot_instance_shader->draw(*_shot_mesh);
+    }
+
+    Magnum::GL::Renderer::disable(Magnum::GL::Renderer::Feature::ScissorTest);
+    Magnum::GL::Renderer::disable(Magnum::GL::Renderer::Feature::Blending);
+}
+
+namespace {
+    // Views of a rectangle inside a larger image, e.g. the ROI inside the planes of an I420 frame (Y, then U and V at
+    // half resolution)
+    Magnum::PixelStorage plane_storage(int row_length, int x, int y) { return Magnum::PixelStorage{}.setAlignment(1).setRowLength(row_length).setSkip({x, y, 0}); }
+
+    Magnum::Matrix4 to_matrix4(const cv::Mat& transformation)
+    {
+        Magnum::Matrix4 matrix;
+        for (std::size_t col = 0; col != 4; ++col)
+            for (std::size_t row = 0; row != 4; ++row)
+                matrix[col][row] = static_cast<Magnum::Float>(transformation.at<double>(row, col));
+        return matrix;
+    }
+} // namespace
+
+bool OpenGLRenderer::_quad_bounds(const cv::Mat& transformation, cv::Rect& bounds) const
+{
+    cv::Rect roi_bounds(0, 0, _rendering_ROI.width, _rendering_ROI.height);
+    Magnum::Matrix4 mat = _proj_matrix * _view_matrix * to_matrix4(transformation);
+    Magnum::Float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (Magnum::Vector2 corner : {Magnum::Vector2{-0.5f, -0.5f}, Magnum::Vector2{0.5f, -0.5f}, Magnum::Vector2{-0.5f, 0.5f}, Magnum::Vector2{0.5f, 0.5f}}) {
+        Magnum::Vector4 clip = mat * Magnum::Vector4{corner.x(), corner.y(), 0.f, 1.f};
+        if (clip.w() <= 0.f) {
+            // Crosses the camera plane, the projection is unbounded
+            bounds = roi_bounds;
+            return true;
+        }
+        Magnum::Vector2 ndc = clip.xy() / clip.w();
+        min_x = std::min(min_x, ndc.x());
+        min_y = std::min(min_y, ndc.y());
+        max_x = std::max(max_x, ndc.x());
+        max_y = std::max(max_y, ndc.y());
+    }
+    // Entirely outside the ROI (clip space)
+    if (max_x < -1.f || min_x > 1.f || max_y < -1.f || min_y > 1.f)
+        return false;
+    // Clamped before the conversion, far-away corners would overflow the pixel coordinates
+    min_x = std::max(min_x, -1.f);
+    min_y = std::max(min_y, -1.f);
+    max_x = std::min(max_x, 1.f);
+    max_y = std::min(max_y, 1.f);
+    // NDC -> layer (ROI, bottom-left origin) -> ROI (top-left origin), one pixel of slack for the filtering
+    int left = static_cast<int>(std::floor((min_x + 1.f) * 0.5f * _rendering_ROI.width)) - 1;
+    int right = static_cast<int>(std::ceil((max_x + 1.f) * 0.5f * _rendering_ROI.width)) + 1;
+    int top = _rendering_ROI.height - static_cast<int>(std::ceil((max_y + 1.f) * 0.5f * _rendering_ROI.height)) - 1;
+    int bottom = _rendering_ROI.height - static_cast<int>(std::floor((min_y + 1.f) * 0.5f * _rendering_ROI.height)) + 1;
+    // Even corners, so that I420 rectangles map onto whole chroma samples
+    left &= ~1;
+    top &= ~1;
+    right = (right + 1) & ~1;
+    bottom = (bottom + 1) & ~1;
+    bounds = cv::Rect(left, top, right - left, bottom - top) & roi_bounds;
+    return !bounds.empty();
+}
+
+void OpenGLRenderer::_update_footprint()
+{
+    _footprint_version++;
+    cv::Rect roi_bounds(0, 0, _rendering_ROI.width, _rendering_ROI.height);
+
+    // Bounding boxes of the projected quads (same corners as _quad_mesh) that reach into the ROI
+    std::vector<cv::Rect> quads;
+    _overlay_bounds = cv::Rect();
+    auto add_quad = [&](const cv::Mat& transformation) {
+        cv::Rect bounds;
+        if (!_quad_bounds(transformation, bounds))
+            return;
+        quads.push_back(bounds);
+        _overlay_bounds |= bounds;
+    };
+
+    if (_region_texture.size() > 0)
+        add_quad(region_transformation);
+    if (_tab_texture.size() > 0)
+        add_quad(tab_transformation);
+    if (_logo_texture.size() > 0)
+        add_quad(logo_transformation);
+    if (_court_texture.size() > 0)
+        add_quad(court_transformation);
+    if (_display.displayShots) {
+        for (const auto& shot : _shots)
+            add_quad(shot.transformation);
+    }
+
+    if (!_footprint_only) {
+        set_segmentation_footprint(_footprint);
+        return;
+    }
+    _footprint = std::move(quads);
+    merge_footprint(_footprint, roi_bounds);
+    set_segmentation_footprint(_footprint);
+}
 
-                (*_textured_quad_shader)
-                    .setTransformationMatrix(mat)
-                    .bindTexture(*_court_texture[0]);
+void OpenGLRenderer::set_segmentation_footprint(const std::vector<cv::Rect>& rects)
+{
+    if (_segment_whole_roi)
+        return;
+    // The clean-up steps run one after another, so their radii add up
+    int reach = 0;
+    for (const auto& step : _mask_steps)
+        reach += step.second;
+    _segmentation_rects = rects;
+    pad_footprint(_segmentation_rects, reach, cv::Rect(0, 0, _rendering_ROI.width, _rendering_ROI.height));
+}
 
-                _textured_quad_shader->draw(*_quad_mesh);
+void OpenGLRenderer::segment_whole_roi()
+{
+    _segmentation_rects.assign(1, cv::Rect(0, 0, _rendering_ROI.width, _rendering_ROI.height));
+    _segment_whole_roi = true;
+}
+
+void OpenGLRenderer::_upload_frame(const cv::Mat& frame, const std::vector<cv::Rect>& rects)
+{
+    // Straight from the frame: the texture keeps the frame's row order (top row first, the shaders flip where they
+    // meet GL render targets), and the row length lets GL pick the rectangle out of the frame rows
+    int row_length = int(frame.step[0] / frame.elemSize());
+    Magnum::Containers::ArrayView<const unsigned char> pixels{frame.data, frame.step[0] * frame.rows};
+    for (const cv::Rect& rect : rects) {
+        cv::Rect target = rect + _rendering_ROI.tl();
+        _frame_texture->setSubImage(0, {rect.x, rect.y}, Magnum::ImageView2D{plane_storage(row_length, target.x, target.y), Magnum::PixelFormat::RGB8Unorm, {rect.width, rect.height}, pixels});
+    }
+}
+
+void OpenGLRenderer::_upload_i420(const cv::Mat& frame, const std::vector<cv::Rect>& rects)
+{
+    // frame holds the I420 planes of a width x height image: Y (height rows), then U and V (height / 4 rows each)
+    int width = frame.cols;
+    int height = frame.rows * 2 / 3;
+    unsigned char* y_plane = frame.data;
+    unsigned char* u_plane = y_plane + width * height;
+    unsigned char* v_plane = u_plane + (width / 2) * (height / 2);
+
+    // The planes are uploaded straight from the frame, top row first; the shader flips when it reads the overlay
+    for (const cv::Rect& rect : rects) {
+        cv::Rect source = rect + _rendering_ROI.tl();
+        Magnum::Vector2i size{rect.width, rect.height};
+        Magnum::Vector2i chroma_size = size / 2;
+        _luma_texture->setSubImage(0, {rect.x, rect.y}, Magnum::ImageView2D{plane_storage(width, source.x, source.y), Magnum::PixelFormat::R8Unorm, size, Magnum::Containers::ArrayView<unsigned char>{y_plane, std::size_t(width * height)}});
+        _chroma_u_texture->setSubImage(0, {rect.x / 2, rect.y / 2}, Magnum::ImageView2D{plane_storage(width / 2, source.x / 2, source.y / 2), Magnum::PixelFormat::R8Unorm, chroma_size, Magnum::Containers::ArrayView<unsigned char>{u_plane, std::size_t((width / 2) * (height / 2))}});
+        _chroma_v_texture->setSubImage(0, {rect.x / 2, rect.y / 2}, Magnum::ImageView2D{plane_storage(width / 2, source.x / 2, source.y / 2), Magnum::PixelFormat::R8Unorm, chroma_size, Magnum::Containers::ArrayView<unsigned char>{v_plane, std::size_t((width / 2) * (height / 2))}});
+    }
+}
+
+OpenGLRenderer::TransferSlot* OpenGLRenderer::_begin_transfer()
+{
+    if (_transfer_slots.empty())
+        return nullptr;
+    if (_slots_in_flight == _transfer_slots.size())
+        finish_render();
+    TransferSlot* slot = &_transfer_slots[_next_slot];
+    _next_slot = (_next_slot + 1) % _transfer_slots.size();
+    _slots_in_flight++;
+    return slot;
+}
+
+void OpenGLRenderer::_set_transfer_planes(const cv::Mat& frame, bool planar)
+{
+    _transfer_planes.clear();
+    if (!planar) {
+        _transfer_planes.push_back({_frame_texture.get(), Magnum::GL::PixelFormat::RGB, 3, 0, 0, frame(_rendering_ROI)});
+        return;
+    }
+
+    // In the slot buffers, rows are counted in chroma widths: the Y plane of the ROI takes twice its height
+    int width = frame.cols;
+    int height = frame.rows * 2 / 3;
+    unsigned char* u_plane = frame.data + width * height;
+    unsigned char* v_plane = u_plane + (width / 2) * (height / 2);
+    cv::Rect chroma_roi(_rendering_ROI.x / 2, _rendering_ROI.y / 2, _rendering_ROI.width / 2, _rendering_ROI.height / 2);
+    _transfer_planes.push_back({_luma_texture.get(), Magnum::GL::PixelFormat::Red, 1, 0, 0, frame.rowRange(0, height)(_rendering_ROI)});
+    _transfer_planes.push_back({_chroma_u_texture.get(), Magnum::GL::PixelFormat::Red, 1, 1, 2 * _rendering_ROI.height, cv::Mat(height / 2, width / 2, CV_8UC1, u_plane)(chroma_roi)});
+    _transfer_planes.push_back({_chroma_v_texture.get(), Magnum::GL::PixelFormat::Red, 1, 1, 2 * _rendering_ROI.height + _rendering_ROI.height / 2, cv::Mat(height / 2, width / 2, CV_8UC1, v_plane)(chroma_roi)});
+}
+
+cv::Mat OpenGLRenderer::_staged(char* base, const TransferPlane& plane, const cv::Rect& rect) const
+{
+    std::size_t row_bytes = std::size_t(_rendering_ROI.width >> plane.shift) * plane.pixel_size;
+    return cv::Mat(rect.height, rect.width, CV_8UC(plane.pixel_size), base + (plane.row_offset + rect.y) * row_bytes + rect.x * plane.pixel_size, row_bytes);
+}
+
+void OpenGLRenderer::_upload_async(TransferSlot& slot, const cv::Mat& frame, bool planar)
+{
+    _set_transfer_planes(frame, planar);
+    Magnum::Containers::ArrayView<char> map = _transfer_persistent ? slot.upload_map : slot.upload->map(0, _transfer_bytes, Magnum::GL::Buffer::MapFlag::Write | Magnum::GL::Buffer::MapFlag::InvalidateBuffer);
+    for (const TransferPlane& plane : _transfer_planes) {
+        for (const cv::Rect& rect : _footprint) {
+            cv::Rect r(rect.x >> plane.shift, rect.y >> plane.shift, rect.width >> plane.shift, rect.height >> plane.shift);
+            cv::Mat staged = _staged(map.data(), plane, r);
+            plane.roi(r).copyTo(staged);
+        }
+    }
+    if (!_transfer_persistent)
+        slot.upload->unmap();
+
+    // The texture updates are sourced from the buffer, so the calls return without waiting for the copy
+    for (const TransferPlane& plane : _transfer_planes) {
+        for (const cv::Rect& rect : _footprint) {
+            cv::Rect r(rect.x >> plane.shift, rect.y >> plane.shift, rect.width >> plane.shift, rect.height >> plane.shift);
+            Magnum::GL::BufferImage2D image{plane_storage(_rendering_ROI.width >> plane.shift, r.x, plane.row_offset + r.y), plane.format, Magnum::GL::PixelType::UnsignedByte, {r.width, r.height}, std::move(*slot.upload), _transfer_bytes};
+            plane.texture->setSubImage(0, {r.x, r.y}, image);
+            *slot.upload = image.release();
+        }
+    }
+}
+
+void OpenGLRenderer::_readback_async(TransferSlot& slot, cv::Mat& frame, bool planar)
+{
+    _set_transfer_planes(frame, planar);
+    for (const TransferPlane& plane : _transfer_planes) {
+        for (const cv::Rect& rect : _footprint) {
+            cv::Rect r(rect.x >> plane.shift, rect.y >> plane.shift, rect.width >> plane.shift, rect.height >> plane.shift);
+            Magnum::Vector2i origin{r.x, r.y};
+            Magnum::Vector2i size{r.width, r.height};
+            Magnum::GL::BufferImage2D image{plane_storage(_rendering_ROI.width >> plane.shift, r.x, plane.row_offset + r.y), plane.format, Magnum::GL::PixelType::UnsignedByte, size, std::move(*slot.readback), _transfer_bytes};
+            plane.texture->subImage(0, {origin, origin + size}, image, Magnum::GL::BufferUsage::StreamRead);
+            *slot.readback = image.release();
+        }
+    }
+    slot.frame = frame;
+    slot.planar = planar;
+    slot.rects = _footprint;
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void OpenGLRenderer::finish_render()
+{
+    if (_slots_in_flight == 0)
+        return;
+    TransferSlot& slot = _transfer_slots[(_next_slot + _transfer_slots.size() - _slots_in_flight) % _transfer_slots.size()];
+    _slots_in_flight--;
+
+    if (slot.fence != nullptr) {
+        // Flush with the first wait, then poll in 1 ms steps
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        GLenum status;
+        while ((status = glClientWaitSync(slot.fence, flags, 1000000)) == GL_TIMEOUT_EXPIRED)
+            flags = 0;
+        if (status == GL_WAIT_FAILED)
+            std::cerr << "Waiting for the render transfers failed" << std::endl;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    if (slot.frame.empty())
+        return;
+
+    Magnum::Containers::ArrayView<char> map = _transfer_persistent ? slot.readback_map : slot.readback->map(0, _transfer_bytes, Magnum::GL::Buffer::MapFlag::Read);
+    _set_transfer_planes(slot.frame, slot.planar);
+    for (const TransferPlane& plane : _transfer_planes) {
+        for (const cv::Rect& rect : slot.rects) {
+            cv::Rect r(rect.x >> plane.shift, rect.y >> plane.shift, rect.width >> plane.shift, rect.height >> plane.shift);
+            cv::Mat dst = plane.roi(r);
+            _staged(map.data(), plane, r).copyTo(dst);
+        }
+    }
+    if (!_transfer_persistent)
+        slot.readback->unmap();
+    slot.frame.release();
+}
+
+void OpenGLRenderer::_upload_mask(const cv::Mat& packed_mask)
+{
+    // Whole words covering every footprint rectangle, top row first like the mask
+    for (const cv::Rect& rect : _footprint) {
+        int first_word = rect.x / 32;
+        int words = packed_mask_words(rect.x + rect.width) - first_word;
+        _mask_texture->setSubImage(0, {first_word, rect.y}, Magnum::ImageView2D{plane_storage(packed_mask.step1(), first_word, rect.y), Magnum::PixelFormat::R32UI, {words, rect.height}, Magnum::Containers::ArrayView<unsigned char>{packed_mask.data, packed_mask.step * packed_mask.rows}});
+    }
+}
+
+void OpenGLRenderer::_segment_on_gpu(Magnum::GL::Texture2D& input)
+{
+    Magnum::UnsignedInt width = _rendering_ROI.width, height = _rendering_ROI.height;
+
+    // The model steps through the clean-up chain by ping-ponging between the two mask textures, so it starts in
+    // whichever one makes the last step land in _mask_texture
+    Magnum::GL::Texture2D* current = (_mask_steps.size() % 2 == 0) ? _mask_texture.get() : _mask_scratch_texture.get();
+    Magnum::GL::Texture2D* other = (current == _mask_texture.get()) ? _mask_scratch_texture.get() : _mask_texture.get();
+
+    // Learning rate 1/(frames seen) until the history is full, like MOG2
+    _model_frames++;
+    float learning_rate = 1.f / static_cast<float>(std::min(_model_frames, _model_history));
+    (*_gaussian_mixture_shader)
+        .setWidth(width)
+        .setHeight(height)
+        .setLearningRate(learning_rate)
+        .setVarThreshold(_model_var_threshold)
+        .setDetectShadows(_model_detect_shadows)
+        .bindInputTexture(input)
+        .bindMaskTexture(*current)
+        .bindModelBuffer(*_model_buffer);
+    for (const cv::Rect& rect : _segmentation_rects) {
+        Magnum::Vector2ui size{Magnum::UnsignedInt(rect.width), Magnum::UnsignedInt(rect.height)};
+        _gaussian_mixture_shader->setRect({Magnum::UnsignedInt(rect.x), Magnum::UnsignedInt(rect.y)}, size);
+        _gaussian_mixture_shader->dispatchCompute({(size.x() + 7) / 8, (size.y() + 7) / 8, 1});
+    }
+
+    Magnum::UnsignedInt tile = Magnum::MaskMorphologyShader::tile_size;
+    for (const auto& step : _mask_steps) {
+        Magnum::GL::Renderer::setMemoryBarrier(Magnum::GL::Renderer::MemoryBarrier::ShaderImageAccess);
+        (*_mask_morphology_shader)
+            .setWidth(width)
+            .setHeight(height)
+            .setOperation(step.first)
+            .setRadius(step.second)
+            .bindInputTexture(*current)
+            .bindOutputTexture(*other);
+        for (const cv::Rect& rect : _segmentation_rects) {
+            _mask_morphology_shader->setRect({rect.x, rect.y}, {rect.width, rect.height});
+            _mask_morphology_shader->dispatchCompute({(Magnum::UnsignedInt(rect.width) + tile - 1) / tile, (Magnum::UnsignedInt(rect.height) + tile - 1) / tile, 1});
+        }
+        std::swap(current, other);
+    }
+    Magnum::GL::Renderer::setMemoryBarrier(Magnum::GL::Renderer::MemoryBarrier::ShaderImageAccess | Magnum::GL::Renderer::MemoryBarrier::ShaderStorage);
+}
+
+Magnum::GL::Texture2D& OpenGLRenderer::_gpu_mask()
+{
+    return (_mask_source != nullptr) ? *_mask_source->_mask_texture : *_mask_texture;
+}
+
+void OpenGLRenderer::segment(const cv::Mat& frame)
+{
+    if (!_opengl_valid || !_gpu_segmentation || _mask_source != nullptr)
+        return;
+    _upload_frame(frame, _segmentation_rects);
+    _frame_resident = true;
+    _segment_on_gpu(*_frame_texture);
+}
+
+void OpenGLRenderer::segment_i420(const cv::Mat& frame)
+{
+    if (!_opengl_valid || !_gpu_segmentation || _mask_source != nullptr)
+        return;
+    _upload_i420(frame, _segmentation_rects);
+    _frame_resident = true;
+    // Luma only: the model runs on the Y plane of the ROI
+    _segment_on_gpu(*_luma_texture);
+}
+
+void OpenGLRenderer::share_mask(const OpenGLRenderer& source)
+{
+    _mask_source = &source;
+}
+
+void OpenGLRenderer::render(cv::Mat& frame, const cv::Mat& foreground_mask, SharedShotData& shots)
+{
+    if (_opengl_valid) {
+        _update_overlays(shots);
+        // Every call takes a slot, composited or not, so that finish_render() completes frames in order
+        TransferSlot* slot = _begin_transfer();
+
+        // With GPU segmentation the ROI is uploaded by segment() for every frame, overlays or not
+        bool frame_resident = _frame_resident;
+        _frame_resident = false;
+
+        if (_shots.size() > 0 && !_footprint.empty()) {
+            if (!frame_resident && slot != nullptr)
+                _upload_async(*slot, frame, false);
+            else if (!frame_resident)
+                _upload_frame(frame, _footprint);
+            // The packed mask goes up as it is, in the same row order as the frame texture
+            if (!_gpu_segmentation)
+                _upload_mask(foreground_mask);
+
+            if (_overlay_dirty) {
+                _draw_overlays();
+                _overlay_dirty = false;
             }
 
-            // Shots
-            if (global::hackyData.displayShots) {
-                for (std::size_t i = 0; i < _shots.size(); i++) {
-                    // Model matrix is different for each shot. Projection and view matrix are the same for all shots.
-                    for (std::size_t col = 0; col != 4; ++col)
-                        for (std::size_t row = 0; row != 4; ++row)
-                            model_matrix[col][row] = static_cast<Magnum::Float>(_shots[i].transformation.at<double>(row, col));
-                    mat = _proj_matrix * _view_matrix * model_matrix;
-
-                    if (_shots[i].made == 1) {
-                        (*_textured_quad_shader)
-                            .setTransformationMatrix(mat)
-                            .bindTexture(*_shot_textures[0]);
-
-                        _textured_quad_shader->draw(*_quad_mesh);
-                    }
-                    else if (_shots[i].made == 0){
-                        (*_textured_quad_shader)
-                            .setTransformationMatrix(mat)
-                            .bindTexture(*_shot_textures[1]);
-
-                        _textured_quad_shader->draw(*_quad_mesh);
-                    }
-                    else if (_shots[i].made == 2){
-                        (*_textured_quad_shader)
-                            .setTransformationMatrix(mat)
-                            .bindTexture(*_shot_textures[2]);
-
-                        _textured_quad_shader->draw(*_quad_mesh);
-                    }
-                }
+            // Run combine mask shader, once per footprint rectangle. The overlay layer is only read, the frame
+            // texture is composited in place.
+            (*_combine_mask_shader)
+                .setWidth(_rendering_ROI.width)
+                .setHeight(_rendering_ROI.height)
+                .bindFrameTexture(*_frame_texture)
+                .bindMaskTexture(_gpu_segmentation ? _gpu_mask() : *_mask_texture)
+                .bindOverlayTexture(*_render_texture);
+            for (const cv::Rect& rect : _footprint) {
+                _combine_mask_shader->setRect({Magnum::UnsignedInt(rect.x), Magnum::UnsignedInt(rect.y)}, {Magnum::UnsignedInt(rect.width), Magnum::UnsignedInt(rect.height)});
+                _combine_mask_shader->dispatchCompute({(Magnum::UnsignedInt(rect.width) + 7) / 8, (Magnum::UnsignedInt(rect.height) + 7) / 8, 1});
             }
-            
+            Magnum::GL::Renderer::setMemoryBarrier(Magnum::GL::Renderer::MemoryBarrier::ShaderImageAccess | Magnum::GL::Renderer::MemoryBarrier::TextureFetch | Magnum::GL::Renderer::MemoryBarrier::ShaderStorage | Magnum::GL::Renderer::MemoryBarrier::TextureUpdate);
 
-            
+            if (slot != nullptr) {
+                _readback_async(*slot, frame, false);
+                return;
+            }
 
-            
+            // Read back straight into the same places of the frame
+            int row_length = int(frame.step[0] / frame.elemSize());
+            Magnum::Containers::ArrayView<unsigned char> pixels{frame.data, frame.step[0] * frame.rows};
+            for (const cv::Rect& rect : _footprint) {
+                cv::Rect target = rect + _rendering_ROI.tl();
+                Magnum::Vector2i origin{rect.x, rect.y};
+                Magnum::Vector2i size{rect.width, rect.height};
+                _frame_texture->subImage(0, {origin, origin + size}, Magnum::MutableImageView2D{plane_storage(row_length, target.x, target.y), Magnum::PixelFormat::RGB8Unorm, size, pixels});
+            }
+        }
+    }
+}
 
-            Magnum::GL::Renderer::disable(Magnum::GL::Renderer::Feature::Blending);
-            // Run combine mask shader
-            Magnum::Int offsetx = _rendering_ROI.x;
-            Magnum::Int offsety = _original_height - _rendering_ROI.y - _rendering_ROI.height;
-            (*_combine_mask_shader)
+void OpenGLRenderer::render_i420(cv::Mat& frame, const cv::Mat& foreground_mask, SharedShotData& shots)
+{
+    if (_opengl_valid) {
+        _update_overlays(shots);
+        TransferSlot* slot = _begin_transfer();
+
+        bool frame_resident = _frame_resident;
+        _frame_resident = false;
+
+        if (_shots.size() > 0 && !_footprint.empty()) {
+            int width = frame.cols;
+            int height = frame.rows * 2 / 3;
+            unsigned char* y_plane = frame.data;
+            unsigned char* u_plane = y_plane + width * height;
+            unsigned char* v_plane = u_plane + (width / 2) * (height / 2);
+
+            if (!frame_resident && slot != nullptr)
+                _upload_async(*slot, frame, true);
+            else if (!frame_resident)
+                _upload_i420(frame, _footprint);
+            if (!_gpu_segmentation)
+                _upload_mask(foreground_mask);
+
+            if (_overlay_dirty) {
+                _draw_overlays();
+                _overlay_dirty = false;
+            }
+
+            // Composite the overlay into the planes, one invocation per 2x2 luma block / chroma sample
+            (*_combine_mask_yuv_shader)
                 .setWidth(_rendering_ROI.width)
                 .setHeight(_rendering_ROI.height)
-                .setOffsetX(offsetx)
-                .setOffsetY(offsety)
-                .bindInputTexture(*_frame_texture)
-                .bindMaskTexture(*_mask_texture)
-                .bindOutputTexture(*_render_texture);
-
-            _combine_mask_shader->dispatchCompute({static_cast<Magnum::UnsignedInt>(_rendering_ROI.width), static_cast<Magnum::UnsignedInt>(_rendering_ROI.height), 1});
-            Magnum::GL::Renderer::setMemoryBarrier(Magnum::GL::Renderer::MemoryBarrier::ShaderImageAccess | Magnum::GL::Renderer::MemoryBarrier::TextureFetch | Magnum::GL::Renderer::MemoryBarrier::ShaderStorage);
-            auto image = _render_texture->subImage(0, {{offsetx, offsety}, {offsetx + _rendering_ROI.width, offsety + _rendering_ROI.height}}, {Magnum::GL::PixelFormat::RGB, Magnum::GL::PixelType::UnsignedByte});
-            Corrade::Containers::StridedArrayView2D<const Magnum::Color3ub> src = image.pixels<Magnum::Color3ub>().flipped<0>();
-            Corrade::Containers::StridedArrayView2D<Magnum::Color3ub> dst{Corrade::Containers::arrayCast<Magnum::Color3ub>(Corrade::Containers::arrayView(fr.data, image.size().product() * sizeof(Magnum::Color3ub))), {std::size_t(image.size().y()), std::size_t(image.size().x())}};
-            Corrade::Utility::copy(src, dst);
-            // Here fr contains the ROI of the frame with the shots rendered on it. We just need to update the corresponding ROI of the original frame with fr.
-            fr.copyTo(frame(_rendering_ROI));
+                .bindLumaTexture(*_luma_texture)
+                .bindChromaTextures(*_chroma_u_texture, *_chroma_v_texture)
+                .bindMaskTexture(_gpu_segmentation ? _gpu_mask() : *_mask_texture)
+                .bindOverlayTexture(*_render_texture);
+            for (const cv::Rect& rect : _footprint) {
+                _combine_mask_yuv_shader->setRect({Magnum::UnsignedInt(rect.x), Magnum::UnsignedInt(rect.y)}, {Magnum::UnsignedInt(rect.width), Magnum::UnsignedInt(rect.height)});
+                _combine_mask_yuv_shader->dispatchCompute({(Magnum::UnsignedInt(rect.width / 2) + 7) / 8, (Magnum::UnsignedInt(rect.height / 2) + 7) / 8, 1});
+            }
+            Magnum::GL::Renderer::setMemoryBarrier(Magnum::GL::Renderer::MemoryBarrier::ShaderImageAccess | Magnum::GL::Renderer::MemoryBarrier::TextureUpdate);
+
+            if (slot != nullptr) {
+                _readback_async(*slot, frame, true);
+                return;
+            }
+
+            // Read the planes back into the same places of the frame
+            for (const cv::Rect& rect : _footprint) {
+                cv::Rect target = rect + _rendering_ROI.tl();
+                Magnum::Vector2i size{rect.width, rect.height};
+                Magnum::Vector2i chroma_size = size / 2;
+                Magnum::Vector2i origin{rect.x, rect.y};
+                Magnum::Vector2i chroma_origin = origin / 2;
+                _luma_texture->subImage(0, {origin, origin + size}, Magnum::MutableImageView2D{plane_storage(width, target.x, target.y), Magnum::PixelFormat::R8Unorm, size, Magnum::Containers::ArrayView<unsigned char>{y_plane, std::size_t(width * height)}});
+                _chroma_u_texture->subImage(0, {chroma_origin, chroma_origin + chroma_size}, Magnum::MutableImageView2D{plane_storage(width / 2, target.x / 2, target.y / 2), Magnum::PixelFormat::R8Unorm, chroma_size, Magnum::Containers::ArrayView<unsigned char>{u_plane, std::size_t((width / 2) * (height / 2))}});
+                _chroma_v_texture->subImage(0, {chroma_origin, chroma_origin + chroma_size}, Magnum::MutableImageView2D{plane_storage(width / 2, target.x / 2, target.y / 2), Magnum::PixelFormat::R8Unorm, chroma_size, Magnum::Containers::ArrayView<unsigned char>{v_plane, std::size_t((width / 2) * (height / 2))}});
+            }
         }
     }
 }
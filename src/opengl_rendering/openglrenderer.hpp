@@ -2,13 +2,18 @@
 #define OPENGL_RENDERING_OPENGLRENDERER_HPP
 
 #include <opengl_rendering/shaders/combine_mask_shader.hpp>
+#include <opengl_rendering/shaders/combine_mask_yuv_shader.hpp>
+#include <opengl_rendering/shaders/gaussian_mixture_shader.hpp>
+#include <opengl_rendering/shaders/mask_morphology_shader.hpp>
 #include <opengl_rendering/shaders/render_texture_shader.hpp>
+#include <opengl_rendering/shaders/shot_instance_shader.hpp>
 #include <opengl_rendering/shaders/textured_quad_shader.hpp>
 #include <opengl_rendering/windowless_contexts.hpp>
 #include <utils/utils.hpp>
 
 #include <opencv2/core.hpp>
 
+#include <Corrade/Containers/Array.h>
 #include <Corrade/Containers/ArrayView.h>
 #include <Corrade/Containers/ArrayViewStl.h>
 #include <Corrade/Containers/Optional.h>
@@ -17,15 +22,21 @@
 #include <Corrade/Utility/Algorithms.h>
 #include <Corrade/Utility/Resource.h>
 
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/BufferImage.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/Framebuffer.h>
 #include <Magnum/GL/ImageFormat.h>
 #include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/OpenGL.h>
 #include <Magnum/GL/PixelFormat.h>
 #include <Magnum/GL/Renderbuffer.h>
 #include <Magnum/GL/RenderbufferFormat.h>
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
 #include <Magnum/GL/TextureFormat.h>
 #include <Magnum/Image.h>
 #include <Magnum/ImageView.h>
@@ -41,6 +52,8 @@
 #include <cnpy/cnpy.h>
 
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace mock_main_arguments {
     // We need those because Magnum::Platform::WindowlessApplication needs to accept argc, argv. Passing those directly in the constructor does not work; they need to be stored in memory (no idea why!).
@@ -68,7 +81,38 @@ public:
     void print_logo_middle();
     void print_stats_on_court(const ShotData& data);
     void print_regions();
+    // foreground_mask is the bit-packed mask of the ROI (see pack_mask)
     void render(cv::Mat& frame, const cv::Mat& foreground_mask, SharedShotData& shots);
+    // Same as render() for frames stored as I420 planes (CV_8UC1, height * 3 / 2 rows). The ROI has to be even-aligned.
+    void render_i420(cv::Mat& frame, const cv::Mat& foreground_mask, SharedShotData& shots);
+    // GPU segmentation (gpu_segmentation in the configuration): updates the background model with the ROI of the frame
+    // and leaves the cleaned-up mask in GPU memory. The next render()/render_i420() call reuses the uploaded frame and
+    // composites with that mask; its foreground_mask argument is ignored.
+    void segment(const cv::Mat& frame);
+    void segment_i420(const cv::Mat& frame);
+    // Composites with the GPU mask of source (another renderer on the same GL context, e.g. the main one of a multi-feed
+    // run). Call before opengl_init(): the renderer then allocates no model of its own and segment() does nothing.
+    void share_mask(const OpenGLRenderer& source);
+    // Picks up a new filter selection from shots, as render() does; lets the caller look at the footprint first
+    void update_overlays(SharedShotData& shots) { _update_overlays(shots); }
+    // Overlay footprint (footprint_only in the configuration): rectangles of the ROI (ROI coordinates, top-left origin,
+    // even-aligned) that overlays project to. Upload, compositing and readback only cover these. The version changes
+    // whenever the rectangles are recomputed. Without footprint_only, this is the whole ROI.
+    const std::vector<cv::Rect>& footprint() const { return _footprint; }
+    std::size_t footprint_version() const { return _footprint_version; }
+    // GPU segmentation: area covered by the model and the clean-up (grown by the reach of the clean-up), e.g. the union
+    // of the footprints of all renderers sharing the mask. Defaults to the own footprint.
+    void set_segmentation_footprint(const std::vector<cv::Rect>& rects);
+    // Offline renders: the model covers the whole ROI from now on, whatever the footprint, so that warm-up frames train
+    // it everywhere (compositing and readback still follow the footprint)
+    void segment_whole_roi();
+    // Asynchronous transfers (transfer_depth > 1 in the configuration): render()/render_i420() only queue the upload,
+    // compositing and readback of a frame and return; the composited pixels are in the frame once finish_render() has
+    // completed it. Frames complete in submission order, one per render() call, and at most transfer_depth of them
+    // are in flight (render() finishes the oldest one itself when the ring is full). Does nothing with a depth of 1.
+    void finish_render();
+    std::size_t frames_in_flight() const { return _slots_in_flight; }
+    std::size_t transfer_depth() const { return _transfer_depth; }
 
     std::size_t get_gpu_id() const;
     std::size_t num_logos() const;
@@ -96,9 +140,16 @@ protected:
     bool _opengl_valid = false;
     std::unique_ptr<Magnum::CombineMaskShader> _combine_mask_shader;
     std::unique_ptr<Magnum::TexturedQuadShader> _textured_quad_shader;
+    std::unique_ptr<Magnum::CombineMaskYUVShader> _combine_mask_yuv_shader;
     std::unique_ptr<Magnum::GL::Texture2D> _frame_texture, _mask_texture;
+    std::unique_ptr<Magnum::GL::Texture2D> _luma_texture, _chroma_u_texture, _chroma_v_texture;
     std::vector<std::unique_ptr<Magnum::GL::Texture2D>> _logo_texture;
-    std::vector<std::unique_ptr<Magnum::GL::Texture2D>> _shot_textures;
+    // Shots: icon texture array and per-shot instance data for one instanced draw (see _upload_shot_instances)
+    std::unique_ptr<Magnum::ShotInstanceShader> _shot_instance_shader;
+    std::unique_ptr<Magnum::GL::Texture2DArray> _shot_texture_array;
+    std::unique_ptr<Magnum::GL::Buffer> _shot_instance_buffer;
+    std::unique_ptr<Magnum::GL::Mesh> _shot_mesh;
+    std::vector<Magnum::Vector4> _shot_instances;
     std::vector<std::unique_ptr<Magnum::GL::Texture2D>> _tab_texture;
     std::vector<std::unique_ptr<Magnum::GL::Texture2D>> _court_texture;
     std::vector<std::unique_ptr<Magnum::GL::Texture2D>> _region_texture;
@@ -108,11 +159,69 @@ protected:
     cv::Mat court_transformation;
     cv::Mat region_transformation;
 
+    // Overlay layer: every overlay rasterized into one RGBA texture of ROI size (the projection is cropped to the ROI).
+    // It is only redrawn when the overlay state changes (_overlay_dirty), the combine passes just read it. Clears and
+    // draws are scissored: _overlay_bounds is the union of the overlay quads in the ROI (top-left origin), _layer_bounds
+    // the part of the layer that is not transparent.
     std::unique_ptr<Magnum::GL::Texture2D> _render_texture;
+    bool _overlay_dirty = true;
+    cv::Rect _overlay_bounds;
+    cv::Rect _layer_bounds;
     std::unique_ptr<Magnum::GL::Mesh> _quad_mesh;
     std::unique_ptr<Magnum::GL::Framebuffer> _framebuffer;
     Magnum::Matrix4 _view_matrix, _proj_matrix;
 
+    // GPU segmentation: per-pixel model, scratch texture for the clean-up steps (ping-pong with _mask_texture)
+    bool _gpu_segmentation = false;
+    bool _gpu_luma_input = false;
+    std::unique_ptr<Magnum::GaussianMixtureShader> _gaussian_mixture_shader;
+    std::unique_ptr<Magnum::MaskMorphologyShader> _mask_morphology_shader;
+    std::unique_ptr<Magnum::GL::Buffer> _model_buffer;
+    std::unique_ptr<Magnum::GL::Texture2D> _mask_scratch_texture;
+    std::vector<std::pair<Magnum::MaskMorphologyShader::Operation, int>> _mask_steps;
+    std::size_t _model_history = 1000;
+    std::size_t _model_frames = 0;
+    float _model_var_threshold = 50.f;
+    bool _model_detect_shadows = true;
+    // The ROI of the current frame was uploaded by segment()/segment_i420() already
+    bool _frame_resident = false;
+    const OpenGLRenderer* _mask_source = nullptr;
+
+    // Overlay footprint, see footprint()
+    bool _footprint_only = false;
+    std::vector<cv::Rect> _footprint;
+    std::size_t _footprint_version = 0;
+    std::vector<cv::Rect> _segmentation_rects;
+    bool _segment_whole_roi = false;
+
+    // Asynchronous transfers, see finish_render(). Every slot has an upload and a readback pixel buffer laid out like
+    // the ROI planes (rows of the plane width, planes back to back as in I420), persistently mapped where
+    // ARB_buffer_storage is available. The fence tells when the GPU is done with both.
+    struct TransferSlot {
+        std::unique_ptr<Magnum::GL::Buffer> upload, readback;
+        Magnum::Containers::ArrayView<char> upload_map, readback_map; // persistent mappings
+        GLsync fence = nullptr;
+        cv::Mat frame; // where the readback goes; empty if nothing was composited
+        bool planar = false;
+        std::vector<cv::Rect> rects;
+    };
+    // One plane of the ROI: its texture, its view in the frame and its first row in the slot buffers
+    struct TransferPlane {
+        Magnum::GL::Texture2D* texture;
+        Magnum::GL::PixelFormat format;
+        int pixel_size;
+        int shift; // 1 for the half-resolution chroma planes
+        int row_offset;
+        cv::Mat roi;
+    };
+    std::size_t _transfer_depth = 1;
+    bool _transfer_persistent = false;
+    std::size_t _transfer_bytes = 0;
+    std::vector<TransferSlot> _transfer_slots;
+    std::size_t _next_slot = 0;
+    std::size_t _slots_in_flight = 0;
+    std::vector<TransferPlane> _transfer_planes;
+
     // Fonts
     cv::Ptr<cv::freetype::FreeType2> _font0;
     cv::Ptr<cv::freetype::FreeType2> _font1;
@@ -137,6 +246,10 @@ protected:
     std::vector<std::string> tab_names;
     Stats stats;
 
+    // Display settings and stats of the last applied filter (snapshot of SharedShotData)
+    HackyData _display;
+    Stats _court_stats;
+
     // Polygons and regions
     Polygon polygon1, polygon2, polygon3, polygon4, polygon5, polygon6, polygon7, polygon8, polygon9;
     Region region1, region2, region3, region4, region5, region6, region7, region8, region9;
@@ -160,6 +273,38 @@ protected:
     void _init_extrinsic_map();
     ShotChartData _read_shot_data(const ShotDataEntry& data);
     ShotChartData add_point(double x, double y);
+    // Picks up a new filter selection from shots (if any) and rebuilds the overlay textures
+    void _update_overlays(SharedShotData& shots);
+    // Refills the instance buffer of the shot mesh from _shots
+    void _upload_shot_instances();
+    // Draws all overlays into _render_texture (when _overlay_dirty)
+    void _draw_overlays();
+    // Bounding box of a projected overlay quad in the ROI (top-left origin, even corners), clipped to it; false if the
+    // quad is outside the ROI
+    bool _quad_bounds(const cv::Mat& transformation, cv::Rect& bounds) const;
+    // Projects the overlay quads into the ROI and rebuilds _overlay_bounds and _footprint
+    void _update_footprint();
+    // Uploads rects of the ROI of the frame into _frame_texture or the plane textures (all top row first, like the frame)
+    void _upload_frame(const cv::Mat& frame, const std::vector<cv::Rect>& rects);
+    void _upload_i420(const cv::Mat& frame, const std::vector<cv::Rect>& rects);
+    // Takes the next slot of the transfer ring (finishing the oldest frame if the ring is full); nullptr when transfers
+    // are synchronous
+    TransferSlot* _begin_transfer();
+    // Fills _transfer_planes for frame (BGR or I420)
+    void _set_transfer_planes(const cv::Mat& frame, bool planar);
+    // Rectangle of a plane (plane coordinates) inside a mapped slot buffer
+    cv::Mat _staged(char* base, const TransferPlane& plane, const cv::Rect& rect) const;
+    // Stages the footprint of the frame in the slot's upload buffer and uploads it from there
+    void _upload_async(TransferSlot& slot, const cv::Mat& frame, bool planar);
+    // Queues the readback of the footprint into the slot's readback buffer and fences the slot
+    void _readback_async(TransferSlot& slot, cv::Mat& frame, bool planar);
+    // Uploads the words of the packed mask that cover the footprint into _mask_texture
+    void _upload_mask(const cv::Mat& packed_mask);
+    // Model update and mask clean-up on input (_frame_texture or _luma_texture) over _segmentation_rects; the result
+    // ends up in _mask_texture
+    void _segment_on_gpu(Magnum::GL::Texture2D& input);
+    // Mask the combine passes read when the mask is computed on the GPU
+    Magnum::GL::Texture2D& _gpu_mask();
 };
 
 #endif
\ No newline at end of file
@@ -22,7 +22,8 @@ namespace Magnum {
     public:
         explicit CombineMaskShader(NoCreateT) : GL::AbstractShaderProgram{NoCreate} {}
 
-        explicit CombineMaskShader()
+        // packed_mask: the mask is a bit-packed R32UI texture (see pack_mask) instead of an R8 one
+        explicit CombineMaskShader(bool packed_mask = false)
         {
             MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL430);
 
@@ -32,6 +33,8 @@ namespace Magnum {
             GL::Shader comp{GL::Version::GL430, GL::Shader::Type::Compute};
 
             comp.addSource("#extension GL_ARB_shader_image_load_store : require\n");
+            if (packed_mask)
+                comp.addSource("#define PACKED_MASK\n");
             comp.addSource(rs.getString("CombineMask.comp"));
 
             CORRADE_INTERNAL_ASSERT_OUTPUT(comp.compile());
@@ -40,11 +43,13 @@ namespace Magnum {
 
             CORRADE_INTERNAL_ASSERT_OUTPUT(link());
 
+            _packed_mask = packed_mask;
+
             /* Get uniform locations */
             _widthUniform = uniformLocation("width");
             _heightUniform = uniformLocation("height");
-            _offsetxUniform = uniformLocation("offset_x");
-            _offsetyUniform = uniformLocation("offset_y");
+            _rectOffsetUniform = uniformLocation("rect_offset");
+            _rectSizeUniform = uniformLocation("rect_size");
         }
 
         CombineMaskShader& setWidth(UnsignedInt width)
@@ -59,39 +64,37 @@ namespace Magnum {
             return *this;
         }
 
-        CombineMaskShader& setOffsetX(UnsignedInt offsetx)
-        {
-            setUniform(_offsetxUniform, offsetx);
-            return *this;
-        }
-
-        CombineMaskShader& setOffsetY(UnsignedInt offsety)
+        // Part of the ROI to composite (top-left corner); dispatch enough groups for its size
+        CombineMaskShader& setRect(const Vector2ui& offset, const Vector2ui& size)
         {
-            setUniform(_offsetyUniform, offsety);
+            setUniform(_rectOffsetUniform, offset);
+            setUniform(_rectSizeUniform, size);
             return *this;
         }
 
-        CombineMaskShader& bindInputTexture(GL::Texture2D& input)
+        // The ROI of the frame; the result is written back into it
+        CombineMaskShader& bindFrameTexture(GL::Texture2D& frame)
         {
-            input.bindImage(_inputPos, 0, GL::ImageAccess::ReadOnly, GL::ImageFormat::RGBA8);
+            frame.bindImage(_framePos, 0, GL::ImageAccess::ReadWrite, GL::ImageFormat::RGBA8);
             return *this;
         }
 
         CombineMaskShader& bindMaskTexture(GL::Texture2D& mask)
         {
-            mask.bindImage(_maskPos, 0, GL::ImageAccess::ReadOnly, GL::ImageFormat::R8);
+            mask.bindImage(_maskPos, 0, GL::ImageAccess::ReadOnly, _packed_mask ? GL::ImageFormat::R32UI : GL::ImageFormat::R8);
             return *this;
         }
 
-        CombineMaskShader& bindOutputTexture(GL::Texture2D& output)
+        CombineMaskShader& bindOverlayTexture(GL::Texture2D& overlay)
         {
-            output.bindImage(_outputPos, 0, GL::ImageAccess::ReadWrite, GL::ImageFormat::RGBA8);
+            overlay.bindImage(_overlayPos, 0, GL::ImageAccess::ReadOnly, GL::ImageFormat::RGBA8);
             return *this;
         }
 
     private:
-        Int _widthUniform, _heightUniform, _offsetxUniform, _offsetyUniform;
-        Int _inputPos = 0, _maskPos = 2, _outputPos = 4;
+        bool _packed_mask = false;
+        Int _widthUniform, _heightUniform, _rectOffsetUniform, _rectSizeUniform;
+        Int _framePos = 0, _maskPos = 2, _overlayPos = 4;
     };
 } // namespace Magnum
 
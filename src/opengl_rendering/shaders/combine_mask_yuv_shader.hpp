@@ -0,0 +1,108 @@
+#ifndef OPENGL_RENDERING_SHADERS_COMBINE_MASK_YUV_SHADER_HPP
+#define OPENGL_RENDERING_SHADERS_COMBINE_MASK_YUV_SHADER_HPP
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Corrade/Utility/Resource.h>
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/ImageFormat.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Matrix4.h>
+
+namespace Magnum {
+
+    // Composites the RGBA overlay layer into the Y, U and V planes of the ROI (I420 frames)
+    class CombineMaskYUVShader : public GL::AbstractShaderProgram {
+    public:
+        explicit CombineMaskYUVShader(NoCreateT) : GL::AbstractShaderProgram{NoCreate} {}
+
+        // packed_mask: the mask is a bit-packed R32UI texture (see pack_mask) instead of an R8 one
+        explicit CombineMaskYUVShader(bool packed_mask = false)
+        {
+            MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL430);
+
+            /* Load and compile shaders from compiled-in resource */
+            Utility::Resource rs("opengl-render-data");
+
+            GL::Shader comp{GL::Version::GL430, GL::Shader::Type::Compute};
+
+            comp.addSource("#extension GL_ARB_shader_image_load_store : require\n");
+            if (packed_mask)
+                comp.addSource("#define PACKED_MASK\n");
+            comp.addSource(rs.getString("CombineMaskYUV.comp"));
+
+            CORRADE_INTERNAL_ASSERT_OUTPUT(comp.compile());
+
+            attachShaders({comp});
+
+            CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+            _packed_mask = packed_mask;
+
+            /* Get uniform locations */
+            _widthUniform = uniformLocation("width");
+            _heightUniform = uniformLocation("height");
+            _rectOffsetUniform = uniformLocation("rect_offset");
+            _rectSizeUniform = uniformLocation("rect_size");
+        }
+
+        CombineMaskYUVShader& setWidth(UnsignedInt width)
+        {
+            setUniform(_widthUniform, width);
+            return *this;
+        }
+
+        CombineMaskYUVShader& setHeight(UnsignedInt height)
+        {
+            setUniform(_heightUniform, height);
+            return *this;
+        }
+
+        // Part of the ROI to composite (top-left corner in luma samples, even); dispatch enough groups for its size
+        CombineMaskYUVShader& setRect(const Vector2ui& offset, const Vector2ui& size)
+        {
+            setUniform(_rectOffsetUniform, offset);
+            setUniform(_rectSizeUniform, size);
+            return *this;
+        }
+
+        CombineMaskYUVShader& bindLumaTexture(GL::Texture2D& luma)
+        {
+            luma.bindImage(_lumaPos, 0, GL::ImageAccess::ReadWrite, GL::ImageFormat::R8);
+            return *this;
+        }
+
+        CombineMaskYUVShader& bindChromaTextures(GL::Texture2D& u, GL::Texture2D& v)
+        {
+            u.bindImage(_chromaUPos, 0, GL::ImageAccess::ReadWrite, GL::ImageFormat::R8);
+            v.bindImage(_chromaVPos, 0, GL::ImageAccess::ReadWrite, GL::ImageFormat::R8);
+            return *this;
+        }
+
+        CombineMaskYUVShader& bindMaskTexture(GL::Texture2D& mask)
+        {
+            mask.bindImage(_maskPos, 0, GL::ImageAccess::ReadOnly, _packed_mask ? GL::ImageFormat::R32UI : GL::ImageFormat::R8);
+            return *this;
+        }
+
+        CombineMaskYUVShader& bindOverlayTexture(GL::Texture2D& overlay)
+        {
+            overlay.bindImage(_overlayPos, 0, GL::ImageAccess::ReadOnly, GL::ImageFormat::RGBA8);
+            return *this;
+        }
+
+    private:
+        bool _packed_mask = false;
+        Int _widthUniform, _heightUniform, _rectOffsetUniform, _rectSizeUniform;
+        Int _lumaPos = 0, _chromaUPos = 1, _maskPos = 2, _chromaVPos = 3, _overlayPos = 4;
+    };
+} // namespace Magnum
+
+#endif
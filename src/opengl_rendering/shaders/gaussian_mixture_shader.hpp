@@ -0,0 +1,127 @@
+#ifndef OPENGL_RENDERING_SHADERS_GAUSSIAN_MIXTURE_SHADER_HPP
+#define OPENGL_RENDERING_SHADERS_GAUSSIAN_MIXTURE_SHADER_HPP
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Corrade/Utility/Resource.h>
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/ImageFormat.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/Version.h>
+
+namespace Magnum {
+
+    // Background model update and classification on the GPU (see GaussianMixture.comp). The model lives in a
+    // shader storage buffer of model_size() bytes per pixel that has to start out zeroed.
+    class GaussianMixtureShader : public GL::AbstractShaderProgram {
+    public:
+        explicit GaussianMixtureShader(NoCreateT) : GL::AbstractShaderProgram{NoCreate} {}
+
+        // luma_input: the input is a single-channel R8 plane instead of the RGBA8 frame texture
+        explicit GaussianMixtureShader(bool luma_input)
+        {
+            MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL430);
+
+            /* Load and compile shaders from compiled-in resource */
+            Utility::Resource rs("opengl-render-data");
+
+            GL::Shader comp{GL::Version::GL430, GL::Shader::Type::Compute};
+
+            comp.addSource("#extension GL_ARB_shader_image_load_store : require\n");
+            if (luma_input)
+                comp.addSource("#define LUMA_INPUT\n");
+            comp.addSource(rs.getString("GaussianMixture.comp"));
+
+            CORRADE_INTERNAL_ASSERT_OUTPUT(comp.compile());
+
+            attachShaders({comp});
+
+            CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+            _luma_input = luma_input;
+
+            /* Get uniform locations */
+            _widthUniform = uniformLocation("width");
+            _heightUniform = uniformLocation("height");
+            _learningRateUniform = uniformLocation("learning_rate");
+            _varThresholdUniform = uniformLocation("var_threshold");
+            _detectShadowsUniform = uniformLocation("detect_shadows");
+            _rectOffsetUniform = uniformLocation("rect_offset");
+            _rectSizeUniform = uniformLocation("rect_size");
+        }
+
+        // 3 components of (mean, variance) plus their weights
+        static constexpr std::size_t model_size() { return 4 * 4 * sizeof(Float); }
+
+        GaussianMixtureShader& setWidth(UnsignedInt width)
+        {
+            setUniform(_widthUniform, width);
+            return *this;
+        }
+
+        GaussianMixtureShader& setHeight(UnsignedInt height)
+        {
+            setUniform(_heightUniform, height);
+            return *this;
+        }
+
+        GaussianMixtureShader& setLearningRate(Float rate)
+        {
+            setUniform(_learningRateUniform, rate);
+            return *this;
+        }
+
+        GaussianMixtureShader& setVarThreshold(Float threshold)
+        {
+            setUniform(_varThresholdUniform, threshold);
+            return *this;
+        }
+
+        GaussianMixtureShader& setDetectShadows(bool detect)
+        {
+            setUniform(_detectShadowsUniform, UnsignedInt(detect));
+            return *this;
+        }
+
+        // Part of the ROI to update; dispatch enough groups for its size
+        GaussianMixtureShader& setRect(const Vector2ui& offset, const Vector2ui& size)
+        {
+            setUniform(_rectOffsetUniform, offset);
+            setUniform(_rectSizeUniform, size);
+            return *this;
+        }
+
+        GaussianMixtureShader& bindInputTexture(GL::Texture2D& input)
+        {
+            input.bindImage(_inputPos, 0, GL::ImageAccess::ReadOnly, _luma_input ? GL::ImageFormat::R8 : GL::ImageFormat::RGBA8);
+            return *this;
+        }
+
+        GaussianMixtureShader& bindMaskTexture(GL::Texture2D& mask)
+        {
+            mask.bindImage(_maskPos, 0, GL::ImageAccess::WriteOnly, GL::ImageFormat::R8);
+            return *this;
+        }
+
+        GaussianMixtureShader& bindModelBuffer(GL::Buffer& model)
+        {
+            model.bind(GL::Buffer::Target::ShaderStorage, _modelPos);
+            return *this;
+        }
+
+    private:
+        bool _luma_input = false;
+        Int _widthUniform, _heightUniform, _learningRateUniform, _varThresholdUniform, _detectShadowsUniform, _rectOffsetUniform, _rectSizeUniform;
+        Int _inputPos = 0, _maskPos = 2;
+        UnsignedInt _modelPos = 0;
+    };
+} // namespace Magnum
+
+#endif
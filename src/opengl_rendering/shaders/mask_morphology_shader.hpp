@@ -0,0 +1,108 @@
+#ifndef OPENGL_RENDERING_SHADERS_MASK_MORPHOLOGY_SHADER_HPP
+#define OPENGL_RENDERING_SHADERS_MASK_MORPHOLOGY_SHADER_HPP
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Corrade/Utility/Resource.h>
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/ImageFormat.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/Version.h>
+
+namespace Magnum {
+
+    // One median/erode/dilate step on a 0/1 mask, tiled through shared memory (see MaskMorphology.comp)
+    class MaskMorphologyShader : public GL::AbstractShaderProgram {
+    public:
+        enum class Operation : UnsignedInt { Majority = 0, Min = 1, Max = 2 };
+
+        // Work group size and the largest radius the shared-memory tile has room for
+        static constexpr Int tile_size = 16;
+        static constexpr Int max_radius = 8;
+
+        explicit MaskMorphologyShader(NoCreateT) : GL::AbstractShaderProgram{NoCreate} {}
+
+        explicit MaskMorphologyShader()
+        {
+            MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL430);
+
+            /* Load and compile shaders from compiled-in resource */
+            Utility::Resource rs("opengl-render-data");
+
+            GL::Shader comp{GL::Version::GL430, GL::Shader::Type::Compute};
+
+            comp.addSource("#extension GL_ARB_shader_image_load_store : require\n");
+            comp.addSource(rs.getString("MaskMorphology.comp"));
+
+            CORRADE_INTERNAL_ASSERT_OUTPUT(comp.compile());
+
+            attachShaders({comp});
+
+            CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+            /* Get uniform locations */
+            _widthUniform = uniformLocation("width");
+            _heightUniform = uniformLocation("height");
+            _operationUniform = uniformLocation("operation");
+            _radiusUniform = uniformLocation("radius");
+            _rectOffsetUniform = uniformLocation("rect_offset");
+            _rectSizeUniform = uniformLocation("rect_size");
+        }
+
+        MaskMorphologyShader& setWidth(UnsignedInt width)
+        {
+            setUniform(_widthUniform, width);
+            return *this;
+        }
+
+        MaskMorphologyShader& setHeight(UnsignedInt height)
+        {
+            setUniform(_heightUniform, height);
+            return *this;
+        }
+
+        MaskMorphologyShader& setOperation(Operation operation)
+        {
+            setUniform(_operationUniform, UnsignedInt(operation));
+            return *this;
+        }
+
+        MaskMorphologyShader& setRadius(Int radius)
+        {
+            setUniform(_radiusUniform, radius);
+            return *this;
+        }
+
+        // Part of the mask to filter; dispatch enough tiles for its size
+        MaskMorphologyShader& setRect(const Vector2i& offset, const Vector2i& size)
+        {
+            setUniform(_rectOffsetUniform, offset);
+            setUniform(_rectSizeUniform, size);
+            return *this;
+        }
+
+        MaskMorphologyShader& bindInputTexture(GL::Texture2D& input)
+        {
+            input.bindImage(_inputPos, 0, GL::ImageAccess::ReadOnly, GL::ImageFormat::R8);
+            return *this;
+        }
+
+        MaskMorphologyShader& bindOutputTexture(GL::Texture2D& output)
+        {
+            output.bindImage(_outputPos, 0, GL::ImageAccess::WriteOnly, GL::ImageFormat::R8);
+            return *this;
+        }
+
+    private:
+        Int _widthUniform, _heightUniform, _operationUniform, _radiusUniform, _rectOffsetUniform, _rectSizeUniform;
+        Int _inputPos = 0, _outputPos = 2;
+    };
+} // namespace Magnum
+
+#endif
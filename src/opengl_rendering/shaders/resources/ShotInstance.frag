@@ -0,0 +1,9 @@
+uniform sampler2DArray textureData;
+
+in vec3 interpolatedTextureCoordinates;
+
+out vec4 color;
+
+void main() {
+    color = texture(textureData, interpolatedTextureCoordinates).rgba;
+}
@@ -0,0 +1,17 @@
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 textureCoordinates;
+// Per shot: position on the court (x, y), scale and icon (layer of the texture array)
+layout(location = 2) in vec4 instanceData;
+
+// Projection * view, the same for every shot
+layout(location = 0)
+uniform highp mat4 transformationMatrix;
+
+out vec3 interpolatedTextureCoordinates;
+
+void main() {
+    interpolatedTextureCoordinates = vec3(textureCoordinates, instanceData.w);
+
+    // Model matrix of a shot: translation times uniform scale in the court plane
+    gl_Position = transformationMatrix * vec4(position.xy * instanceData.z + instanceData.xy, position.z, 1.);
+}
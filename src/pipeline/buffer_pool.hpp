@@ -0,0 +1,44 @@
+#ifndef PIPELINE_BUFFER_POOL_HPP
+#define PIPELINE_BUFFER_POOL_HPP
+
+#include <pipeline/spsc_queue.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+
+// Fixed set of preallocated cv::Mat buffers that are handed out and returned instead of being freed.
+// Buffers are acquired by one stage and released by another, so the free list is a SPSC queue:
+// exactly one thread may call acquire() and exactly one thread may call release().
+class BufferPool {
+public:
+    BufferPool(std::size_t count, cv::Size size, int type) : _size(size), _type(type), _free(count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            _free.try_push(cv::Mat(size, type));
+    }
+
+    // Blocks until a buffer is returned if the pool is exhausted (acts as backpressure on the producer)
+    cv::Mat acquire()
+    {
+        cv::Mat buffer;
+        _free.pop(buffer);
+        return buffer;
+    }
+
+    // Buffers that do not match the pool geometry (e.g. empty end-of-stream packets) are simply dropped
+    void release(cv::Mat&& buffer)
+    {
+        if (buffer.size() == _size && buffer.type() == _type)
+            _free.push(std::move(buffer));
+    }
+
+    std::size_t available() const { return _free.size(); }
+
+protected:
+    cv::Size _size;
+    int _type;
+    SPSCQueue<cv::Mat> _free;
+};
+
+#endif
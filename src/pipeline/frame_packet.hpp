@@ -0,0 +1,29 @@
+#ifndef PIPELINE_FRAME_PACKET_HPP
+#define PIPELINE_FRAME_PACKET_HPP
+
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <cstddef>
+
+// Unit of work passed between the streamer stages (decode -> segmentation -> render -> encode)
+struct FramePacket {
+    std::size_t index = 0;
+    cv::Mat frame;
+    cv::Mat foreground_mask; // bit-packed, see pack_mask
+    // Live mode: time by which the frame has to be written, and what happened to it on the way
+    std::chrono::steady_clock::time_point deadline;
+    bool late = false;
+    bool drop = false;
+    // Set on the last packet of a stream; every stage forwards it and then exits
+    bool end_of_stream = false;
+
+    static FramePacket end_of_stream_marker()
+    {
+        FramePacket packet;
+        packet.end_of_stream = true;
+        return packet;
+    }
+};
+
+#endif
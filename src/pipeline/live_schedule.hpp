@@ -0,0 +1,91 @@
+#ifndef PIPELINE_LIVE_SCHEDULE_HPP
+#define PIPELINE_LIVE_SCHEDULE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+using LiveClock = std::chrono::steady_clock;
+
+// What the pipeline does with a frame that is going to miss its deadline
+enum class LatePolicy {
+    Drop, // the frame is not written at all
+    PassThrough, // the frame is written without overlay
+    ReuseMask // segmentation is skipped and the previous foreground mask is used
+};
+
+inline LatePolicy late_policy_from_string(const std::string& name)
+{
+    if (name == "drop")
+        return LatePolicy::Drop;
+    if (name == "reuse_mask")
+        return LatePolicy::ReuseMask;
+    if (name != "passthrough")
+        std::cerr << "Unknown late frame policy '" << name << "'. Using 'passthrough'." << std::endl;
+    return LatePolicy::PassThrough;
+}
+
+// Frame i of the input is due at start + i / fps (files are paced by that) and has to leave the pipeline within the
+// latency budget after it was actually read. The clock starts with the first frame read and is re-anchored whenever
+// the source falls more than one budget behind it, so that startup latency or a source slightly slower than its
+// nominal rate does not leave every later frame late.
+class FrameSchedule {
+public:
+    FrameSchedule(double fps, double latency_budget_ms)
+        : _frame_period(std::chrono::duration_cast<LiveClock::duration>(std::chrono::duration<double>((fps > 0.) ? 1. / fps : 0.))),
+          _latency_budget(std::chrono::duration_cast<LiveClock::duration>(std::chrono::duration<double, std::milli>(latency_budget_ms)))
+    {
+    }
+
+    bool started() const { return _started; }
+    LiveClock::time_point arrival(std::size_t index) const { return _start + _frame_period * static_cast<long>(index); }
+
+    // Frame index has just been read: returns its deadline
+    LiveClock::time_point arrived(std::size_t index)
+    {
+        LiveClock::time_point now = LiveClock::now();
+        if (!_started || now > arrival(index) + _latency_budget) {
+            _start = now - _frame_period * static_cast<long>(index);
+            _started = true;
+        }
+        return now + _latency_budget;
+    }
+
+protected:
+    LiveClock::duration _frame_period;
+    LiveClock::duration _latency_budget;
+    LiveClock::time_point _start;
+    bool _started = false;
+};
+
+// Moving average of how long a stage takes per frame. Written by the stage itself, read by any stage that needs to
+// predict whether a frame can still make its deadline.
+class StageCost {
+public:
+    void add(LiveClock::duration elapsed)
+    {
+        double us = std::chrono::duration<double, std::micro>(elapsed).count();
+        double ema = _ema_us.load(std::memory_order_relaxed);
+        _ema_us.store((ema == 0.) ? us : ema + _alpha * (us - ema), std::memory_order_relaxed);
+    }
+
+    LiveClock::duration estimate() const
+    {
+        return std::chrono::duration_cast<LiveClock::duration>(std::chrono::duration<double, std::micro>(_ema_us.load(std::memory_order_relaxed)));
+    }
+
+protected:
+    static constexpr double _alpha = 0.1;
+    std::atomic<double> _ema_us{0.};
+};
+
+struct LiveCounters {
+    std::atomic<std::size_t> late{0}; // frames that missed (or were predicted to miss) their deadline
+    std::atomic<std::size_t> dropped{0};
+    std::atomic<std::size_t> passed_through{0};
+    std::atomic<std::size_t> reused_masks{0};
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef PIPELINE_OVERLAY_FOOTPRINT_HPP
+#define PIPELINE_OVERLAY_FOOTPRINT_HPP
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Part of the rendering ROI that overlays cover, as rectangles in ROI coordinates. Only there the foreground mask is
+// needed, so segmentation, mask upload, compositing and readback can skip the rest of the ROI.
+
+// Merges overlapping rectangles (in place), so that no pixel is processed twice. Rectangles that end up covering most
+// of bounds are replaced by bounds itself, where one large pass is cheaper than many small ones.
+inline void merge_footprint(std::vector<cv::Rect>& rects, const cv::Rect& bounds)
+{
+    for (auto& rect : rects)
+        rect &= bounds;
+    rects.erase(std::remove_if(rects.begin(), rects.end(), [](const cv::Rect& r) { return r.empty(); }), rects.end());
+
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (std::size_t i = 0; i < rects.size() && !merged; i++) {
+            for (std::size_t j = i + 1; j < rects.size(); j++) {
+                if ((rects[i] & rects[j]).empty())
+                    continue;
+                rects[i] |= rects[j];
+                rects.erase(rects.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    long area = 0;
+    for (const auto& rect : rects)
+        area += rect.area();
+    if (area > bounds.area() / 2) {
+        rects.assign(1, bounds);
+    }
+}
+
+// Grows every rectangle by margin pixels (e.g. the reach of a filter that needs context) and merges the result
+inline void pad_footprint(std::vector<cv::Rect>& rects, int margin, const cv::Rect& bounds)
+{
+    // Even margins keep even corners (whole chroma samples in I420)
+    margin += margin & 1;
+    for (auto& rect : rects)
+        rect = cv::Rect(rect.x - margin, rect.y - margin, rect.width + 2 * margin, rect.height + 2 * margin);
+    merge_footprint(rects, bounds);
+}
+
+// Zeroes (background) every pixel of mask outside the rectangles, which must not overlap (see merge_footprint)
+inline void clear_outside_footprint(cv::Mat& mask, const std::vector<cv::Rect>& rects)
+{
+    for (int y = 0; y < mask.rows; y++) {
+        unsigned char* row = mask.ptr(y);
+        int x = 0;
+        while (x < mask.cols) {
+            // Leftmost rectangle on this row that ends after x; everything before it is cleared
+            int next = mask.cols, end = mask.cols;
+            for (const auto& rect : rects) {
+                if (y >= rect.y && y < rect.y + rect.height && rect.x + rect.width > x && rect.x < next) {
+                    next = std::max(rect.x, x);
+                    end = rect.x + rect.width;
+                }
+            }
+            std::memset(row + x, 0, next - x);
+            x = end;
+        }
+    }
+}
+
+// Footprint published by the render stage and picked up by the segmentation stage. The version changes with every
+// publish, so readers only copy the rectangles when they changed.
+class OverlayFootprint {
+public:
+    void publish(const std::vector<cv::Rect>& rects)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _rects = rects;
+        _version++;
+    }
+
+    // Copies the rectangles into rects if they changed since version; returns the current version
+    std::size_t snapshot(std::vector<cv::Rect>& rects, std::size_t version) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_version != version)
+            rects = _rects;
+        return _version;
+    }
+
+protected:
+    mutable std::mutex _mutex;
+    std::vector<cv::Rect> _rects;
+    std::size_t _version = 0;
+};
+
+#endif
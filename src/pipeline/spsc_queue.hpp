@@ -0,0 +1,107 @@
+#ifndef PIPELINE_SPSC_QUEUE_HPP
+#define PIPELINE_SPSC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity lock-free ring buffer for exactly one producer thread and one consumer thread.
+// Items are popped in the order they were pushed, so frame order is kept between pipeline stages.
+template <typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(std::size_t capacity) : _slots(std::max<std::size_t>(capacity, 1) + 1), _buffer(_slots) {}
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    void operator=(const SPSCQueue&) = delete;
+
+    // Returns false (and leaves item untouched) if the queue is full
+    bool try_push(T&& item)
+    {
+        const std::size_t head = _head.load(std::memory_order_relaxed);
+        const std::size_t next = _next(head);
+        if (next == _tail.load(std::memory_order_acquire))
+            return false;
+        _buffer[head] = std::move(item);
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty
+    bool try_pop(T& item)
+    {
+        const std::size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+            return false;
+        item = std::move(_buffer[tail]);
+        _tail.store(_next(tail), std::memory_order_release);
+        return true;
+    }
+
+    // Blocking variants: spin for a short while, then back off with short sleeps so an idle stage does not burn a core
+    void push(T&& item)
+    {
+        for (std::size_t spins = 0; !try_push(std::move(item)); spins++)
+            _backoff(spins);
+    }
+
+    void pop(T& item)
+    {
+        for (std::size_t spins = 0; !try_pop(item); spins++)
+            _backoff(spins);
+    }
+
+    // Approximate when called concurrently with push/pop; good enough for occupancy reporting
+    std::size_t size() const
+    {
+        const std::size_t head = _head.load(std::memory_order_acquire);
+        const std::size_t tail = _tail.load(std::memory_order_acquire);
+        return (head + _slots - tail) % _slots;
+    }
+
+    std::size_t capacity() const { return _slots - 1; }
+
+private:
+    std::size_t _next(std::size_t idx) const { return (idx + 1 == _slots) ? 0 : idx + 1; }
+
+    static void _backoff(std::size_t spins)
+    {
+        if (spins < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    // One slot is always left empty to tell "full" apart from "empty"
+    const std::size_t _slots;
+    std::vector<T> _buffer;
+    // head/tail on separate cache lines so producer and consumer do not false-share
+    alignas(64) std::atomic<std::size_t> _head{0};
+    alignas(64) std::atomic<std::size_t> _tail{0};
+};
+
+// Running statistics of how full a queue is. A queue that is mostly full points to a slow consumer stage,
+// a queue that is mostly empty points to a slow producer stage.
+struct QueueOccupancy {
+    std::string name;
+    std::size_t capacity = 0;
+    std::size_t samples = 0;
+    std::size_t sum = 0;
+    std::size_t peak = 0;
+
+    void sample(std::size_t size)
+    {
+        samples++;
+        sum += size;
+        peak = std::max(peak, size);
+    }
+
+    double mean() const { return (samples > 0) ? static_cast<double>(sum) / samples : 0.; }
+};
+
+#endif
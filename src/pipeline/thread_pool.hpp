@@ -0,0 +1,105 @@
+#ifndef PIPELINE_THREAD_POOL_HPP
+#define PIPELINE_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel work inside one pipeline stage (e.g. segmentation tiles).
+// parallel_for() is called by a single owner thread, which also takes part in the work. No allocation per call.
+class ThreadPool {
+public:
+    // num_threads includes the calling thread, so ThreadPool(1) runs everything inline
+    ThreadPool(std::size_t num_threads)
+    {
+        for (std::size_t i = 1; i < num_threads; i++)
+            _workers.emplace_back([this]() { _worker_loop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _work_ready.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return _workers.size() + 1; }
+
+    // Calls task(i) for every i in [0, count) and returns once all calls have finished
+    template <typename Task>
+    void parallel_for(std::size_t count, Task& task)
+    {
+        if (_workers.empty() || count <= 1) {
+            for (std::size_t i = 0; i < count; i++)
+                task(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _task = &task;
+            _invoke = [](void* t, std::size_t i) { (*static_cast<Task*>(t))(i); };
+            _count = count;
+            _next.store(0);
+            _busy = _workers.size();
+            _generation++;
+        }
+        _work_ready.notify_all();
+
+        _run_tasks();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _work_done.wait(lock, [this]() { return _busy == 0; });
+    }
+
+protected:
+    void _run_tasks()
+    {
+        for (std::size_t i = _next++; i < _count; i = _next++)
+            _invoke(_task, i);
+    }
+
+    void _worker_loop()
+    {
+        std::size_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _work_ready.wait(lock, [&]() { return _stop || _generation != seen_generation; });
+                if (_stop)
+                    return;
+                seen_generation = _generation;
+            }
+
+            _run_tasks();
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_busy == 0)
+                _work_done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _work_ready, _work_done;
+    bool _stop = false;
+    std::size_t _generation = 0;
+    std::size_t _busy = 0;
+
+    void* _task = nullptr;
+    void (*_invoke)(void*, std::size_t) = nullptr;
+    std::size_t _count = 0;
+    std::atomic<std::size_t> _next{0};
+};
+
+#endif
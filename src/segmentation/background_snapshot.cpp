@@ -0,0 +1,227 @@
+#include "background_snapshot.hpp"
+
+#include <cnpy/cnpy.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Views of the planes of a frame or plate: the image itself for BGR; Y, U and V for I420 (any element type)
+    std::vector<cv::Mat> planes(const cv::Mat& image, bool planar)
+    {
+        if (!planar)
+            return {image};
+        int height = image.rows * 2 / 3, width = image.cols;
+        unsigned char* chroma = const_cast<unsigned char*>(image.ptr(height));
+        std::size_t plane_bytes = std::size_t(width / 2) * (height / 2) * image.elemSize();
+        return {image.rowRange(0, height), cv::Mat(height / 2, width / 2, image.type(), chroma), cv::Mat(height / 2, width / 2, image.type(), chroma + plane_bytes)};
+    }
+
+    // rect on plane p (chroma planes are half resolution)
+    cv::Rect plane_rect(const cv::Rect& rect, std::size_t p)
+    {
+        return p == 0 ? rect : cv::Rect(rect.x / 2, rect.y / 2, rect.width / 2, rect.height / 2);
+    }
+
+    // FNV-1a: stable across runs and builds, unlike std::hash
+    void hash_bytes(std::uint64_t& hash, const char* data, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+} // namespace
+
+std::string background_snapshot_path(const StreamerConfiguration& config, bool planar)
+{
+    if (config.snapshot_directory.empty())
+        return "";
+
+    std::uint64_t hash = 14695981039346656037ull;
+    std::ifstream calibration_file(config.calibration_path, std::ios::binary);
+    std::string calibration((std::istreambuf_iterator<char>(calibration_file)), std::istreambuf_iterator<char>());
+    hash_bytes(hash, calibration.data(), calibration.size());
+    const cv::Rect& roi = config.rendering_ROI;
+    std::ostringstream setup;
+    setup << roi.x << ',' << roi.y << ',' << roi.width << ',' << roi.height << ',' << (planar ? "i420" : "bgr");
+    std::string setup_string = setup.str();
+    hash_bytes(hash, setup_string.data(), setup_string.size());
+
+    std::ostringstream name;
+    name << "background_" << config.snapshot_venue << '_' << std::hex << std::setw(16) << std::setfill('0') << hash << ".npz";
+    return (fs::path(config.snapshot_directory) / name.str()).string();
+}
+
+bool save_background_snapshot(const std::string& path, const BackgroundSnapshot& snapshot)
+{
+    if (path.empty() || snapshot.empty())
+        return false;
+
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+    std::string tmp_path = path + ".tmp";
+    try {
+        cv::Mat plate = snapshot.plate.isContinuous() ? snapshot.plate : snapshot.plate.clone();
+        cv::Mat deviation = snapshot.deviation.isContinuous() ? snapshot.deviation : snapshot.deviation.clone();
+        cnpy::npz_save(tmp_path, "plate", plate.ptr<unsigned char>(), {std::size_t(plate.rows), std::size_t(plate.cols), std::size_t(plate.channels())}, "w");
+        cnpy::npz_save(tmp_path, "deviation", deviation.ptr<unsigned char>(), {std::size_t(deviation.rows), std::size_t(deviation.cols)}, "a");
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Could not save the background snapshot to " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    fs::rename(tmp_path, path, error);
+    if (error) {
+        std::cerr << "Could not save the background snapshot to " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_background_snapshot(const std::string& path, const cv::Size& roi_size, bool planar, BackgroundSnapshot& snapshot)
+{
+    if (path.empty() || !fs::exists(path))
+        return false;
+
+    cnpy::npz_t npz;
+    try {
+        npz = cnpy::npz_load(path);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Could not read the background snapshot " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    auto plate = npz.find("plate"), deviation = npz.find("deviation");
+    std::vector<std::size_t> plate_shape = {std::size_t(planar ? roi_size.height * 3 / 2 : roi_size.height), std::size_t(roi_size.width), std::size_t(planar ? 1 : 3)};
+    std::vector<std::size_t> deviation_shape = {std::size_t(roi_size.height), std::size_t(roi_size.width)};
+    if (plate == npz.end() || deviation == npz.end() || plate->second.shape != plate_shape || deviation->second.shape != deviation_shape || plate->second.word_size != 1
+        || deviation->second.word_size != 1) {
+        std::cerr << "The background snapshot " << path << " does not match the ROI or pixel format. Ignoring it." << std::endl;
+        return false;
+    }
+
+    snapshot.plate.create(int(plate_shape[0]), roi_size.width, planar ? CV_8UC1 : CV_8UC3);
+    std::copy_n(plate->second.data<unsigned char>(), snapshot.plate.total() * snapshot.plate.elemSize(), snapshot.plate.ptr<unsigned char>());
+    snapshot.deviation.create(roi_size, CV_8UC1);
+    std::copy_n(deviation->second.data<unsigned char>(), snapshot.deviation.total(), snapshot.deviation.ptr<unsigned char>());
+    return true;
+}
+
+void synthesize_background(const BackgroundSnapshot& snapshot, const cv::Rect& roi, const cv::Rect& rect, bool planar, cv::RNG& rng, cv::Mat& frame)
+{
+    std::vector<cv::Mat> plate_planes = planes(snapshot.plate, planar), frame_planes = planes(frame, planar);
+    for (std::size_t p = 0; p < plate_planes.size(); p++) {
+        cv::Rect r = plane_rect(rect, p);
+        cv::Mat src = plate_planes[p](r), dst = frame_planes[p](plane_rect(roi, p))(r);
+        if (p > 0) {
+            src.copyTo(dst);
+            continue;
+        }
+
+        // For Gaussian noise, sigma = sqrt(pi / 2) * mean absolute deviation (per channel)
+        int channels = src.channels();
+        cv::Mat noise(r.size(), CV_32FC(channels));
+        rng.fill(noise, cv::RNG::NORMAL, 0., 1.);
+        for (int y = 0; y < r.height; y++) {
+            const unsigned char* plate_row = src.ptr<unsigned char>(y);
+            const unsigned char* deviation_row = snapshot.deviation.ptr<unsigned char>(r.y + y) + r.x;
+            const float* noise_row = noise.ptr<float>(y);
+            unsigned char* frame_row = dst.ptr<unsigned char>(y);
+            for (int x = 0; x < r.width; x++) {
+                float sigma = deviation_row[x] * 1.2533f / channels;
+                for (int c = 0; c < channels; c++)
+                    frame_row[x * channels + c] = cv::saturate_cast<unsigned char>(plate_row[x * channels + c] + sigma * noise_row[x * channels + c]);
+            }
+        }
+    }
+}
+
+BackgroundStatistics::BackgroundStatistics(const cv::Rect& roi, bool planar, std::size_t update_interval)
+    : _roi(roi), _planar(planar), _update_interval(std::max<std::size_t>(1, update_interval))
+{
+    if (planar)
+        _plate = cv::Mat::zeros(roi.height * 3 / 2, roi.width, CV_32FC1);
+    else
+        _plate = cv::Mat::zeros(roi.size(), CV_32FC3);
+    _deviation = cv::Mat::zeros(roi.size(), CV_32FC1);
+    _counts = cv::Mat::zeros(roi.size(), CV_8UC1);
+}
+
+void BackgroundStatistics::seed(const BackgroundSnapshot& snapshot)
+{
+    snapshot.plate.convertTo(_plate, CV_32F);
+    snapshot.deviation.convertTo(_deviation, CV_32F);
+    _counts.setTo(31);
+    _updates = 1;
+}
+
+void BackgroundStatistics::update(const cv::Mat& frame, const cv::Mat& mask, const std::vector<cv::Rect>& rects)
+{
+    if (_frames++ % _update_interval != 0)
+        return;
+    _updates++;
+
+    std::vector<cv::Mat> frame_planes = planes(frame, _planar), plate_planes = planes(_plate, _planar);
+    for (std::size_t p = 0; p < frame_planes.size(); p++)
+        frame_planes[p] = frame_planes[p](plane_rect(_roi, p));
+    if (rects.empty()) {
+        _update_rect(frame_planes, plate_planes, mask, cv::Rect(0, 0, _roi.width, _roi.height));
+        return;
+    }
+    for (const cv::Rect& rect : rects)
+        _update_rect(frame_planes, plate_planes, mask, rect);
+}
+
+void BackgroundStatistics::_update_rect(const std::vector<cv::Mat>& frame_planes, const std::vector<cv::Mat>& plate_planes, const cv::Mat& mask, const cv::Rect& rect)
+{
+    // Chroma first: a chroma sample goes by the mask and count of its top-left luma pixel, before the luma pass
+    // increments that count
+    for (std::size_t p = plate_planes.size(); p-- > 0;) {
+        cv::Rect r = plane_rect(rect, p);
+        cv::Mat src = frame_planes[p](r), plate = plate_planes[p](r);
+        int step = (p == 0) ? 1 : 2;
+        int channels = src.channels();
+        for (int y = 0; y < src.rows; y++) {
+            const unsigned char* frame_row = src.ptr<unsigned char>(y);
+            const unsigned char* mask_row = mask.ptr<unsigned char>(rect.y + y * step) + rect.x;
+            unsigned char* count_row = _counts.ptr<unsigned char>(rect.y + y * step) + rect.x;
+            float* plate_row = plate.ptr<float>(y);
+            float* deviation_row = _deviation.ptr<float>(rect.y + y) + rect.x;
+            for (int x = 0; x < src.cols; x++) {
+                if (mask_row[x * step] != 0)
+                    continue;
+                unsigned char& count = count_row[x * step];
+                float alpha = 1.f / (count + 1);
+                if (p == 0) {
+                    if (count > 0) {
+                        float d = 0.f;
+                        for (int c = 0; c < channels; c++)
+                            d += std::abs(frame_row[x * channels + c] - plate_row[x * channels + c]);
+                        deviation_row[x] += alpha * (d - deviation_row[x]);
+                    }
+                    count = std::min(count + 1, 31);
+                }
+                for (int c = 0; c < channels; c++)
+                    plate_row[x * channels + c] += alpha * (frame_row[x * channels + c] - plate_row[x * channels + c]);
+            }
+        }
+    }
+}
+
+void BackgroundStatistics::snapshot(BackgroundSnapshot& snapshot) const
+{
+    _plate.convertTo(snapshot.plate, CV_MAKETYPE(CV_8U, _plate.channels()));
+    _deviation.convertTo(snapshot.deviation, CV_8U);
+}
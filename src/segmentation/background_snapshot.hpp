@@ -0,0 +1,69 @@
+#ifndef SEGMENTATION_BACKGROUND_SNAPSHOT_HPP
+#define SEGMENTATION_BACKGROUND_SNAPSHOT_HPP
+
+#include <utils/utils.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// What the segmentation has learnt about the background of the ROI, in a form that outlives the model: the plate
+// (the ROI without foreground, laid out like the frames: CV_8UC3 BGR, or CV_8UC1 with the Y plane followed by the
+// half-resolution U and V planes, rows * 3 / 2 rows) and the noise around it (per-pixel mean absolute deviation from
+// the plate, summed over the channels; luma only for I420). OpenCV's models cannot be serialized, so segmenters are
+// warm-started from this instead (see ForegroundSegmenter::warm_start).
+struct BackgroundSnapshot {
+    cv::Mat plate;
+    cv::Mat deviation; // CV_8UC1, ROI size
+
+    bool empty() const { return plate.empty(); }
+};
+
+// <snapshot_directory>/background_<venue>_<key>.npz. The key is a hash of the calibration file, the ROI and the pixel
+// format (I420 if planar), so a snapshot is only picked up by the camera setup it was taken with. Empty if snapshots
+// are disabled.
+std::string background_snapshot_path(const StreamerConfiguration& config, bool planar);
+
+// npz with a "plate" and a "deviation" array. The file is written under a temporary name and then renamed, so a crash
+// while saving leaves the previous snapshot intact.
+bool save_background_snapshot(const std::string& path, const BackgroundSnapshot& snapshot);
+// Returns false if there is no snapshot or it does not fit the ROI size and pixel format
+bool load_background_snapshot(const std::string& path, const cv::Size& roi_size, bool planar, BackgroundSnapshot& snapshot);
+
+// Writes rect (ROI coordinates, even-aligned for I420) of the plate into the ROI of frame, with Gaussian noise of the
+// recorded amplitude on luma/BGR. frame must already have the size and type of the input frames.
+void synthesize_background(const BackgroundSnapshot& snapshot, const cv::Rect& roi, const cv::Rect& rect, bool planar, cv::RNG& rng, cv::Mat& frame);
+
+// Running per-pixel mean of the background pixels of the ROI and of their deviation from it, taken every
+// update_interval-th frame. The mean becomes an exponential average after 32 samples of a pixel, so the plate follows
+// lighting changes over a run.
+class BackgroundStatistics {
+public:
+    BackgroundStatistics(const cv::Rect& roi, bool planar, std::size_t update_interval = 10);
+
+    // Continues from a loaded snapshot
+    void seed(const BackgroundSnapshot& snapshot);
+    // mask is the byte mask of the ROI (0: background), valid inside rects (ROI coordinates, even-aligned for I420;
+    // empty: the whole ROI)
+    void update(const cv::Mat& frame, const cv::Mat& mask, const std::vector<cv::Rect>& rects = {});
+    bool empty() const { return _updates == 0; }
+    void snapshot(BackgroundSnapshot& snapshot) const;
+
+protected:
+    void _update_rect(const std::vector<cv::Mat>& frame_planes, const std::vector<cv::Mat>& plate_planes, const cv::Mat& mask, const cv::Rect& rect);
+
+    cv::Rect _roi;
+    bool _planar;
+    std::size_t _update_interval;
+    std::size_t _frames = 0;
+    std::size_t _updates = 0;
+    // Same layout as BackgroundSnapshot::plate, CV_32F
+    cv::Mat _plate;
+    cv::Mat _deviation;
+    // Background samples per pixel, saturating at 31
+    cv::Mat _counts;
+};
+
+#endif
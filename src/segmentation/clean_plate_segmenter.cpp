@@ -0,0 +1,238 @@
+#include "clean_plate_segmenter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLEAN_PLATE_X86 1
+#endif
+
+namespace {
+    // Row kernels. absdiff: out[i] = |a[i] - b[i]| over n bytes. classify_luma: mask[x] = 255 if |a[x] - b[x]| > threshold[x].
+
+    void absdiff_scalar(const std::uint8_t* a, const std::uint8_t* b, std::uint8_t* out, int n)
+    {
+        for (int i = 0; i < n; i++)
+            out[i] = (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+    }
+
+    void classify_luma_scalar(const std::uint8_t* a, const std::uint8_t* b, const std::uint16_t* threshold, std::uint8_t* mask, int width)
+    {
+        for (int x = 0; x < width; x++) {
+            int d = (a[x] > b[x]) ? a[x] - b[x] : b[x] - a[x];
+            mask[x] = (d > threshold[x]) ? 255 : 0;
+        }
+    }
+
+#ifdef CLEAN_PLATE_X86
+    __attribute__((target("avx2"))) inline __m256i absdiff_epu8(__m256i a, __m256i b)
+    {
+        return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+    }
+
+    __attribute__((target("avx2"))) void absdiff_avx2(const std::uint8_t* a, const std::uint8_t* b, std::uint8_t* out, int n)
+    {
+        int i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), absdiff_epu8(va, vb));
+        }
+        absdiff_scalar(a + i, b + i, out + i, n - i);
+    }
+
+    __attribute__((target("avx2"))) void classify_luma_avx2(const std::uint8_t* a, const std::uint8_t* b, const std::uint16_t* threshold, std::uint8_t* mask, int width)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i d = absdiff_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + x)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + x)));
+            // Widen to 16 bits for the comparison with the thresholds (values stay far below the signed limit)
+            __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(d));
+            __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(d, 1));
+            __m256i above_lo = _mm256_cmpgt_epi16(lo, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(threshold + x)));
+            __m256i above_hi = _mm256_cmpgt_epi16(hi, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(threshold + x + 16)));
+            // packs works per 128-bit lane, the permute restores the pixel order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(above_lo, above_hi), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mask + x), packed);
+        }
+        classify_luma_scalar(a + x, b + x, threshold + x, mask + x, width - x);
+    }
+#endif
+
+    struct RowKernels {
+        void (*absdiff)(const std::uint8_t*, const std::uint8_t*, std::uint8_t*, int);
+        void (*classify_luma)(const std::uint8_t*, const std::uint8_t*, const std::uint16_t*, std::uint8_t*, int);
+    };
+
+    const RowKernels& row_kernels()
+    {
+        static const RowKernels kernels = []() {
+            RowKernels k{absdiff_scalar, classify_luma_scalar};
+#ifdef CLEAN_PLATE_X86
+            if (__builtin_cpu_supports("avx2"))
+                k = RowKernels{absdiff_avx2, classify_luma_avx2};
+#endif
+            return k;
+        }();
+        return kernels;
+    }
+
+    cv::Range band_rows(std::size_t band, std::size_t num_bands, int rows)
+    {
+        return cv::Range(static_cast<int>(band * rows / num_bands), static_cast<int>((band + 1) * rows / num_bands));
+    }
+} // namespace
+
+CleanPlateSegmenter::CleanPlateSegmenter(const StreamerConfiguration& config, ThreadPool& pool, bool planar)
+    : ForegroundSegmenter(config.rendering_ROI, planar), _pool(pool), _plate_frames(std::max<std::size_t>(1, config.clean_plate_frames)),
+      _num_samples(std::clamp<std::size_t>(config.clean_plate_samples, 1, _plate_frames)), _noise_factor(config.clean_plate_noise_factor),
+      _min_threshold(config.clean_plate_min_threshold), _drift_interval(config.clean_plate_drift_interval), _band_diff(pool.size()), _band_values(pool.size()),
+      _band_distances(pool.size())
+{
+    _sample_stride = std::max<std::size_t>(1, _plate_frames / _num_samples);
+    _samples.reserve(_num_samples);
+}
+
+void CleanPlateSegmenter::apply(const cv::Mat& frame, cv::Mat& mask)
+{
+    // I420: the Y plane is the first two thirds of the rows
+    cv::Mat roi = _planar ? frame.rowRange(0, frame.rows * 2 / 3)(_roi) : frame(_roi);
+
+    if (!is_ready() && _frames % _sample_stride == 0) {
+        _samples.push_back(roi.clone());
+        _samples_taken++;
+        // Rough plates early on, the final one once every sample is in
+        std::size_t n = _samples.size();
+        if ((n & (n - 1)) == 0 || n == _num_samples)
+            _build_plate();
+        if (is_ready())
+            std::vector<cv::Mat>().swap(_samples);
+    }
+    _frames++;
+
+    // Sampling always covers the whole ROI so that the plate is complete when the footprint moves
+    mask.create(roi.size(), CV_8UC1);
+    bool drift = _drift_interval > 0 && is_ready() && _frames % _drift_interval == 0;
+    if (_footprint.empty()) {
+        cv::Rect whole(0, 0, roi.cols, roi.rows);
+        _classify(roi, mask, whole);
+        if (drift)
+            _drift(roi, mask, whole);
+        return;
+    }
+    for (const cv::Rect& rect : _footprint) {
+        _classify(roi, mask, rect);
+        if (drift)
+            _drift(roi, mask, rect);
+    }
+}
+
+void CleanPlateSegmenter::warm_start(const BackgroundSnapshot& snapshot, const cv::Size&, std::size_t)
+{
+    // Same model, nothing to replay: the snapshot deviation is a mean absolute deviation, 1.2533 * MAD ~ sigma
+    (_planar ? snapshot.plate.rowRange(0, _roi.height) : snapshot.plate).copyTo(_plate);
+    cv::Mat threshold;
+    snapshot.deviation.convertTo(threshold, CV_64F, _noise_factor * 1.2533, _min_threshold);
+    cv::min(threshold, 255. * _plate.channels(), threshold);
+    threshold.convertTo(_threshold, CV_16U);
+    _samples_taken = _num_samples;
+    _frames = _plate_frames;
+    std::vector<cv::Mat>().swap(_samples);
+}
+
+void CleanPlateSegmenter::_build_plate()
+{
+    int channels = _samples.front().channels();
+    int rows = _samples.front().rows, cols = _samples.front().cols;
+    _plate.create(rows, cols, CV_MAKETYPE(CV_8U, channels));
+    _threshold.create(rows, cols, CV_16UC1);
+    std::size_t n = _samples.size();
+    std::size_t num_bands = _band_values.size();
+
+    auto build_band = [&](std::size_t band) {
+        std::vector<std::uint8_t>& values = _band_values[band];
+        std::vector<int>& distances = _band_distances[band];
+        values.resize(n);
+        distances.resize(n);
+        cv::Range range = band_rows(band, num_bands, rows);
+        for (int y = range.start; y < range.end; y++) {
+            std::uint8_t* plate = _plate.ptr<std::uint8_t>(y);
+            std::uint16_t* threshold = _threshold.ptr<std::uint16_t>(y);
+            for (int x = 0; x < cols; x++) {
+                // Median per channel
+                for (int c = 0; c < channels; c++) {
+                    for (std::size_t s = 0; s < n; s++)
+                        values[s] = _samples[s].ptr<std::uint8_t>(y)[x * channels + c];
+                    std::nth_element(values.begin(), values.begin() + n / 2, values.end());
+                    plate[x * channels + c] = values[n / 2];
+                }
+                // Noise: median absolute deviation of the samples' colour distance to the plate (1.4826 * MAD ~ sigma)
+                for (std::size_t s = 0; s < n; s++) {
+                    const std::uint8_t* sample = _samples[s].ptr<std::uint8_t>(y) + x * channels;
+                    int d = 0;
+                    for (int c = 0; c < channels; c++)
+                        d += std::abs(int(sample[c]) - int(plate[x * channels + c]));
+                    distances[s] = d;
+                }
+                std::nth_element(distances.begin(), distances.begin() + n / 2, distances.end());
+                double t = _min_threshold + _noise_factor * 1.4826 * distances[n / 2];
+                threshold[x] = static_cast<std::uint16_t>(std::min(t, 255. * channels));
+            }
+        }
+    };
+    _pool.parallel_for(num_bands, build_band);
+}
+
+void CleanPlateSegmenter::_classify(const cv::Mat& frame_roi, cv::Mat& frame_mask, const cv::Rect& rect)
+{
+    const RowKernels& k = row_kernels();
+    cv::Mat roi = frame_roi(rect), mask = frame_mask(rect), plate = _plate(rect), thresholds = _threshold(rect);
+    int channels = roi.channels();
+    std::size_t num_bands = _band_diff.size();
+
+    auto classify_band = [&](std::size_t band) {
+        std::vector<std::uint8_t>& diff = _band_diff[band];
+        diff.resize(roi.cols * channels);
+        cv::Range range = band_rows(band, num_bands, roi.rows);
+        for (int y = range.start; y < range.end; y++) {
+            const std::uint8_t* frame_row = roi.ptr<std::uint8_t>(y);
+            const std::uint8_t* plate_row = plate.ptr<std::uint8_t>(y);
+            const std::uint16_t* threshold = thresholds.ptr<std::uint16_t>(y);
+            std::uint8_t* mask_row = mask.ptr<std::uint8_t>(y);
+            if (channels == 1) {
+                k.classify_luma(frame_row, plate_row, threshold, mask_row, roi.cols);
+                continue;
+            }
+            // Colour: byte-wise differences first, then the per-pixel sum
+            k.absdiff(frame_row, plate_row, diff.data(), roi.cols * 3);
+            for (int x = 0; x < roi.cols; x++) {
+                int d = diff[3 * x] + diff[3 * x + 1] + diff[3 * x + 2];
+                mask_row[x] = (d > threshold[x]) ? 255 : 0;
+            }
+        }
+    };
+    _pool.parallel_for(num_bands, classify_band);
+}
+
+void CleanPlateSegmenter::_drift(const cv::Mat& frame_roi, const cv::Mat& frame_mask, const cv::Rect& rect)
+{
+    // One grey level towards the current frame, on background pixels only so that players do not burn in
+    cv::Mat roi = frame_roi(rect), mask = frame_mask(rect), plate = _plate(rect);
+    int channels = roi.channels();
+    for (int y = 0; y < roi.rows; y++) {
+        const std::uint8_t* frame_row = roi.ptr<std::uint8_t>(y);
+        const std::uint8_t* mask_row = mask.ptr<std::uint8_t>(y);
+        std::uint8_t* plate_row = plate.ptr<std::uint8_t>(y);
+        for (int x = 0; x < roi.cols; x++) {
+            if (mask_row[x] != 0)
+                continue;
+            for (int c = 0; c < channels; c++) {
+                std::uint8_t& p = plate_row[x * channels + c];
+                std::uint8_t v = frame_row[x * channels + c];
+                p += (v > p) - (v < p);
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef SEGMENTATION_CLEAN_PLATE_SEGMENTER_HPP
+#define SEGMENTATION_CLEAN_PLATE_SEGMENTER_HPP
+
+#include <pipeline/thread_pool.hpp>
+#include <segmentation/foreground_segmenter.hpp>
+#include <utils/utils.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Static camera, known floor: the background is a single clean plate instead of a per-pixel mixture model.
+// The plate is the per-pixel median of frames sampled from the first config.clean_plate_frames frames (rebuilt a few
+// times while they come in, so early frames get a rough plate), together with a per-pixel noise threshold derived
+// from how much the samples scatter around it. A pixel is foreground when its colour distance (sum of absolute
+// channel differences) to the plate exceeds its threshold. Optionally the plate drifts by one grey level towards
+// background pixels every drift_interval frames, to follow slow lighting changes.
+// I420 frames use the Y plane only. warm_start() takes the plate and the noise straight from the snapshot.
+class CleanPlateSegmenter : public ForegroundSegmenter {
+public:
+    CleanPlateSegmenter(const StreamerConfiguration& config, ThreadPool& pool, bool planar);
+
+    void apply(const cv::Mat& frame, cv::Mat& mask) override;
+    void warm_start(const BackgroundSnapshot& snapshot, const cv::Size& frame_size, std::size_t frames) override;
+
+    // All samples are in and the plate is final (apart from drift)
+    bool is_ready() const { return _samples_taken >= _num_samples; }
+
+protected:
+    void _build_plate();
+    // Both work on rect (ROI coordinates) only
+    void _classify(const cv::Mat& roi, cv::Mat& mask, const cv::Rect& rect);
+    void _drift(const cv::Mat& roi, const cv::Mat& mask, const cv::Rect& rect);
+
+    ThreadPool& _pool;
+    std::size_t _plate_frames, _num_samples, _sample_stride;
+    double _noise_factor;
+    int _min_threshold;
+    std::size_t _drift_interval;
+    std::size_t _frames = 0;
+    std::size_t _samples_taken = 0;
+
+    std::vector<cv::Mat> _samples;
+    cv::Mat _plate; // CV_8UC1 or CV_8UC3
+    cv::Mat _threshold; // CV_16UC1, per pixel
+    // Per band scratch: absolute differences of a row, sample values of a pixel
+    std::vector<std::vector<std::uint8_t>> _band_diff, _band_values;
+    std::vector<std::vector<int>> _band_distances;
+};
+
+#endif
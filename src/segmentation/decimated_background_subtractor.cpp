@@ -0,0 +1,86 @@
+#include "decimated_background_subtractor.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Activity and motion are measured on 1/8 resolution thumbnails
+    constexpr int thumbnail_factor = 8;
+} // namespace
+
+DecimatedBackgroundSubtractor::DecimatedBackgroundSubtractor(cv::Ptr<cv::BackgroundSubtractor> model, Mode mode, std::size_t max_interval, double base_learning_rate, double activity_threshold, std::size_t warmup_frames)
+    : _model(model), _mode(mode), _max_interval(std::max<std::size_t>(1, max_interval)), _base_learning_rate(base_learning_rate), _activity_threshold(activity_threshold), _warmup_frames(warmup_frames)
+{
+}
+
+double DecimatedBackgroundSubtractor::_update_activity(const cv::Mat& image)
+{
+    if (image.channels() == 3)
+        cv::cvtColor(image, _gray, cv::COLOR_BGR2GRAY);
+    else
+        _gray = image;
+    std::swap(_thumbnail, _previous_thumbnail);
+    cv::resize(_gray, _thumbnail_8u, cv::Size(std::max(1, image.cols / thumbnail_factor), std::max(1, image.rows / thumbnail_factor)), 0., 0., cv::INTER_AREA);
+    _thumbnail_8u.convertTo(_thumbnail, CV_32F);
+    if (_previous_thumbnail.size() != _thumbnail.size())
+        return _activity_threshold; // no history yet: treat as active
+    cv::absdiff(_thumbnail, _previous_thumbnail, _diff);
+    return cv::mean(_diff)[0];
+}
+
+void DecimatedBackgroundSubtractor::apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate)
+{
+    cv::Mat input = image.getMat();
+    double activity = _update_activity(input);
+
+    // Fast play: back to updating every frame right away
+    if (activity >= _activity_threshold)
+        _interval = 1;
+
+    _frames++;
+    _since_update++;
+    bool update = _frames <= _warmup_frames || _since_update >= _interval || _previous_mask.empty();
+    if (update) {
+        // Quiet scene: stretch the interval by one frame per update
+        if (activity < 0.5 * _activity_threshold)
+            _interval = std::min(_max_interval, _interval + 1);
+
+        // The model sees 1/N of the frames, so it has to learn N times faster to keep the same time constant
+        double rate = learningRate;
+        if (rate < 0. && _frames > _warmup_frames)
+            rate = std::min(1., _base_learning_rate * static_cast<double>(_since_update));
+        _model->apply(input, fgmask, rate);
+        _since_update = 0;
+        fgmask.getMat().copyTo(_previous_mask);
+        return;
+    }
+
+    if (_mode == Mode::Frozen) {
+        _model->apply(input, fgmask, 0.);
+        return;
+    }
+
+    // Shift: phase correlation of the thumbnails gives the global translation since the previous frame
+    cv::Point2d shift = cv::phaseCorrelate(_previous_thumbnail, _thumbnail);
+    cv::Matx23d translation(1., 0., shift.x * thumbnail_factor, 0., 1., shift.y * thumbnail_factor);
+    fgmask.create(input.size(), CV_8UC1);
+    cv::Mat mask = fgmask.getMat();
+    cv::warpAffine(_previous_mask, mask, translation, input.size(), cv::INTER_NEAREST, cv::BORDER_REPLICATE);
+    mask.copyTo(_previous_mask);
+}
+
+void DecimatedBackgroundSubtractor::getBackgroundImage(cv::OutputArray backgroundImage) const
+{
+    _model->getBackgroundImage(backgroundImage);
+}
+
+DecimatedBackgroundSubtractor::Mode decimation_mode_from_string(const std::string& name)
+{
+    if (name == "shift")
+        return DecimatedBackgroundSubtractor::Mode::Shift;
+    if (name != "frozen")
+        std::cerr << "Unknown decimation mode '" << name << "'. Using 'frozen'." << std::endl;
+    return DecimatedBackgroundSubtractor::Mode::Frozen;
+}
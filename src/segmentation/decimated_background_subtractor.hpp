@@ -0,0 +1,51 @@
+#ifndef SEGMENTATION_DECIMATED_BACKGROUND_SUBTRACTOR_HPP
+#define SEGMENTATION_DECIMATED_BACKGROUND_SUBTRACTOR_HPP
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#include <cstddef>
+#include <string>
+
+// Updates the background model only on every Nth frame. Frames in between are either classified against the frozen
+// model (no learning) or get the previous mask shifted by the global motion between the frames. N adapts to the scene:
+// it grows while little changes between frames and drops back to 1 as soon as the activity rises.
+class DecimatedBackgroundSubtractor : public cv::BackgroundSubtractor {
+public:
+    enum class Mode {
+        Frozen, // classify against the model without updating it
+        Shift // translate the previous mask by the estimated global motion
+    };
+
+    // base_learning_rate is the per-frame rate of the model (1 / history for MOG2); update frames use N times that.
+    // activity_threshold is the mean absolute difference (grey levels) between consecutive frames above which every
+    // frame updates the model. The first warmup_frames frames always update.
+    DecimatedBackgroundSubtractor(cv::Ptr<cv::BackgroundSubtractor> model, Mode mode, std::size_t max_interval, double base_learning_rate, double activity_threshold, std::size_t warmup_frames);
+
+    void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1) override;
+    void getBackgroundImage(cv::OutputArray backgroundImage) const override;
+
+    std::size_t interval() const { return _interval; }
+
+protected:
+    // Mean absolute difference between this frame's thumbnail and the previous one
+    double _update_activity(const cv::Mat& image);
+
+    cv::Ptr<cv::BackgroundSubtractor> _model;
+    Mode _mode;
+    std::size_t _max_interval;
+    double _base_learning_rate;
+    double _activity_threshold;
+    std::size_t _warmup_frames;
+
+    std::size_t _frames = 0;
+    std::size_t _interval = 1;
+    std::size_t _since_update = 0;
+
+    cv::Mat _gray, _thumbnail_8u, _thumbnail, _previous_thumbnail, _diff;
+    cv::Mat _previous_mask;
+};
+
+DecimatedBackgroundSubtractor::Mode decimation_mode_from_string(const std::string& name);
+
+#endif
@@ -0,0 +1,144 @@
+#include "foreground_segmenter.hpp"
+
+#include <segmentation/clean_plate_segmenter.hpp>
+#include <segmentation/decimated_background_subtractor.hpp>
+#include <segmentation/scaled_background_subtractor.hpp>
+#include <segmentation/tiled_background_subtractor.hpp>
+#include <segmentation/torch_segmenter.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+void ForegroundSegmenter::apply_batch(const std::vector<const cv::Mat*>& frames, const std::vector<cv::Mat*>& masks)
+{
+    for (std::size_t i = 0; i < frames.size(); i++)
+        apply(*frames[i], *masks[i]);
+}
+
+cv::Mat ForegroundSegmenter::_synthetic_frame(const cv::Size& frame_size) const
+{
+    if (_planar)
+        return cv::Mat::zeros(frame_size.height * 3 / 2, frame_size.width, CV_8UC1);
+    return cv::Mat::zeros(frame_size, CV_8UC3);
+}
+
+void ForegroundSegmenter::warm_start(const BackgroundSnapshot& snapshot, const cv::Size& frame_size, std::size_t frames)
+{
+    cv::Mat frame = _synthetic_frame(frame_size), mask;
+    cv::RNG rng;
+    cv::Rect whole(0, 0, _roi.width, _roi.height);
+    for (std::size_t i = 0; i < frames; i++) {
+        synthesize_background(snapshot, _roi, whole, _planar, rng, frame);
+        apply(frame, mask);
+    }
+}
+
+BackgroundSubtractorSegmenter::BackgroundSubtractorSegmenter(Factory factory, const cv::Rect& roi, bool planar, bool use_chroma)
+    : ForegroundSegmenter(roi, planar), _factory(std::move(factory)), _i420_segmentation(use_chroma)
+{
+    _back_sub = _factory();
+}
+
+void BackgroundSubtractorSegmenter::set_footprint(const std::vector<cv::Rect>& rects)
+{
+    // Keep the models of rectangles that are still there
+    std::vector<cv::Ptr<cv::BackgroundSubtractor>> models(rects.size());
+    for (std::size_t i = 0; i < rects.size(); i++) {
+        auto it = std::find(_footprint.begin(), _footprint.end(), rects[i]);
+        if (it != _footprint.end()) {
+            models[i] = _footprint_models[it - _footprint.begin()];
+            continue;
+        }
+        models[i] = _factory();
+        if (_warm_frames == 0)
+            continue;
+        // Only the rectangle is synthesized, so this costs about as much as warm_frames frames of the rectangle
+        cv::Mat frame = _synthetic_frame(_frame_size), mask;
+        cv::RNG rng;
+        for (std::size_t f = 0; f < _warm_frames; f++) {
+            synthesize_background(_snapshot, _roi, rects[i], _planar, rng, frame);
+            _apply_model(*models[i], frame, rects[i] + _roi.tl(), mask);
+        }
+    }
+    _footprint_models = std::move(models);
+    _footprint = rects;
+}
+
+void BackgroundSubtractorSegmenter::warm_start(const BackgroundSnapshot& snapshot, const cv::Size& frame_size, std::size_t frames)
+{
+    _snapshot = snapshot;
+    _frame_size = frame_size;
+    _warm_frames = frames;
+    ForegroundSegmenter::warm_start(snapshot, frame_size, frames);
+}
+
+void BackgroundSubtractorSegmenter::_apply_model(cv::BackgroundSubtractor& model, const cv::Mat& frame, const cv::Rect& rect, cv::Mat& mask)
+{
+    if (_planar)
+        _i420_segmentation.apply(model, frame, rect, mask);
+    else
+        model.apply(frame(rect), mask);
+}
+
+void BackgroundSubtractorSegmenter::apply(const cv::Mat& frame, cv::Mat& mask)
+{
+    if (_footprint.empty()) {
+        _apply_model(*_back_sub, frame, _roi, mask);
+        return;
+    }
+
+    mask.create(_roi.size(), CV_8UC1);
+    for (std::size_t i = 0; i < _footprint.size(); i++) {
+        const cv::Rect& rect = _footprint[i];
+        // The sub-mask already has the right size and type, so the model writes straight into it
+        cv::Mat mask_rect = mask(rect);
+        _apply_model(*_footprint_models[i], frame, rect + _roi.tl(), mask_rect);
+    }
+}
+
+std::unique_ptr<ForegroundSegmenter> create_foreground_segmenter(const StreamerConfiguration& config, ThreadPool& pool, bool planar)
+{
+    if (config.segmenter == "torch") {
+#ifdef STREAMER_WITH_TORCH
+        auto segmenter = std::make_unique<TorchSegmenter>(config, planar);
+        if (segmenter->is_loaded())
+            return segmenter;
+        std::cerr << "Could not load the segmentation model. Falling back to 'mog2'." << std::endl;
+#else
+        std::cerr << "Built without libtorch, the 'torch' segmenter is not available. Falling back to 'mog2'." << std::endl;
+#endif
+    }
+    else if (config.segmenter == "clean_plate") {
+        return std::make_unique<CleanPlateSegmenter>(config, pool, planar);
+    }
+    else if (config.segmenter != "mog2" && config.segmenter != "knn") {
+        std::cerr << "Unknown segmenter '" << config.segmenter << "'. Falling back to 'mog2'." << std::endl;
+    }
+
+    // Called once for the whole ROI and once per footprint rectangle
+    bool knn = (config.segmenter == "knn");
+    auto factory = [config, knn, &pool]() {
+        auto create_model = [&config, knn]() -> cv::Ptr<cv::BackgroundSubtractor> {
+            if (knn)
+                return cv::createBackgroundSubtractorKNN(config.bg_sub_history, config.knn_distance_threshold, config.detect_shadows);
+            return cv::createBackgroundSubtractorMOG2(config.bg_sub_history, config.distance_threshold, config.detect_shadows);
+        };
+
+        // With segmentation threads, the ROI is split into tiles with one model each, updated in parallel on the pool
+        cv::Ptr<cv::BackgroundSubtractor> back_sub;
+        if (config.segmentation_tiles_x * config.segmentation_tiles_y > 1)
+            back_sub = cv::makePtr<TiledBackgroundSubtractor>(config.segmentation_tiles_x, config.segmentation_tiles_y, pool, create_model);
+        else
+            back_sub = create_model();
+        // Reduced-resolution model: the mask is upsampled to the ROI guided by the full-resolution frame
+        if (config.model_scale > 1)
+            back_sub = cv::makePtr<ScaledBackgroundSubtractor>(config.model_scale, back_sub);
+        // Temporal decimation: the model is updated every Nth frame, N adapting to the activity in the scene
+        if (config.decimation_max_interval > 1) {
+            back_sub = cv::makePtr<DecimatedBackgroundSubtractor>(back_sub, decimation_mode_from_string(config.decimation_mode), config.decimation_max_interval, 1. / config.bg_sub_history,
+                config.decimation_activity_threshold, config.bg_sub_history);
+        }
+        return back_sub;
+    };
+    return std::make_unique<BackgroundSubtractorSegmenter>(factory, config.rendering_ROI, planar, config.segmentation_chroma);
+}
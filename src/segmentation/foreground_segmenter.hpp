@@ -0,0 +1,80 @@
+#ifndef SEGMENTATION_FOREGROUND_SEGMENTER_HPP
+#define SEGMENTATION_FOREGROUND_SEGMENTER_HPP
+
+#include <pipeline/thread_pool.hpp>
+#include <segmentation/background_snapshot.hpp>
+#include <segmentation/i420_segmentation.hpp>
+#include <utils/utils.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Computes the raw foreground mask of the rendering ROI (CV_8UC1: 0 background, 127 shadow, 255 foreground) for
+// whole frames (BGR, or I420 planes when planar). Post-processing is done by the caller (MaskPostProcessor).
+class ForegroundSegmenter {
+public:
+    ForegroundSegmenter(const cv::Rect& roi, bool planar) : _roi(roi), _planar(planar) {}
+    virtual ~ForegroundSegmenter() = default;
+
+    virtual void apply(const cv::Mat& frame, cv::Mat& mask) = 0;
+
+    // Frames the segmenter would like to get per apply_batch() call; per-frame models want 1
+    virtual std::size_t batch_size() const { return 1; }
+    // Segments several frames at once (in order). The default calls apply() on each frame.
+    virtual void apply_batch(const std::vector<const cv::Mat*>& frames, const std::vector<cv::Mat*>& masks);
+
+    // Restricts segmentation to these rectangles (ROI coordinates, even-aligned, not overlapping; see OverlayFootprint).
+    // Empty means the whole ROI. Mask pixels outside the rectangles are left undefined.
+    virtual void set_footprint(const std::vector<cv::Rect>& rects) { _footprint = rects; }
+
+    // Starts from a saved background instead of learning it from the first frames. The default feeds frames frames of
+    // the plate with noise of the recorded amplitude through apply(); frame_size is the size of the input frames.
+    virtual void warm_start(const BackgroundSnapshot& snapshot, const cv::Size& frame_size, std::size_t frames);
+
+protected:
+    // Synthetic input frame for warm_start()
+    cv::Mat _synthetic_frame(const cv::Size& frame_size) const;
+
+    cv::Rect _roi;
+    bool _planar;
+    std::vector<cv::Rect> _footprint;
+};
+
+// MOG2/KNN and the wrappers around them (tiles, reduced resolution, temporal decimation).
+// With a footprint, every rectangle gets a model of its own. Models are kept as long as their rectangle stays in the
+// footprint; a new rectangle starts with a fresh model, which needs a few frames to learn the background (or is
+// warm-started from the snapshot given to warm_start()).
+class BackgroundSubtractorSegmenter : public ForegroundSegmenter {
+public:
+    using Factory = std::function<cv::Ptr<cv::BackgroundSubtractor>()>;
+
+    BackgroundSubtractorSegmenter(Factory factory, const cv::Rect& roi, bool planar, bool use_chroma);
+
+    void apply(const cv::Mat& frame, cv::Mat& mask) override;
+    void set_footprint(const std::vector<cv::Rect>& rects) override;
+    void warm_start(const BackgroundSnapshot& snapshot, const cv::Size& frame_size, std::size_t frames) override;
+
+protected:
+    // rect is in frame coordinates
+    void _apply_model(cv::BackgroundSubtractor& model, const cv::Mat& frame, const cv::Rect& rect, cv::Mat& mask);
+
+    Factory _factory;
+    cv::Ptr<cv::BackgroundSubtractor> _back_sub;
+    std::vector<cv::Ptr<cv::BackgroundSubtractor>> _footprint_models;
+    I420Segmentation _i420_segmentation;
+    // Kept to warm-start the models of new footprint rectangles
+    BackgroundSnapshot _snapshot;
+    cv::Size _frame_size;
+    std::size_t _warm_frames = 0;
+};
+
+// Segmenter selected by config.segmenter ("mog2", "knn", "torch" or "clean_plate"). Falls back to MOG2 for unknown names or when
+// the selected backend is not available. pool runs the tiles of the background models.
+std::unique_ptr<ForegroundSegmenter> create_foreground_segmenter(const StreamerConfiguration& config, ThreadPool& pool, bool planar);
+
+#endif
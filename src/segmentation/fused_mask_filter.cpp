@@ -0,0 +1,306 @@
+#include "fused_mask_filter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FUSED_MASK_FILTER_X86 1
+#endif
+
+namespace {
+    // Mask values are 0/1 inside the filter. Horizontal kernels: out[x] = f(in[x], ..., in[x + n - 1]).
+    // Vertical kernels: out[x] = f(rows[0][x], ..., rows[n - 1][x]).
+    struct RowKernels {
+        void (*hmin)(const std::uint8_t*, std::uint8_t*, int, int);
+        void (*hmax)(const std::uint8_t*, std::uint8_t*, int, int);
+        void (*hsum)(const std::uint8_t*, std::uint8_t*, int, int);
+        void (*vmin)(const std::uint8_t* const*, int, std::uint8_t*, int);
+        void (*vmax)(const std::uint8_t* const*, int, std::uint8_t*, int);
+        // out[x] = sum > threshold
+        void (*vmajority)(const std::uint8_t* const*, int, std::uint8_t*, int, int);
+    };
+
+    void hmin_scalar(const std::uint8_t* in, std::uint8_t* out, int width, int n)
+    {
+        for (int x = 0; x < width; x++) {
+            std::uint8_t v = in[x];
+            for (int d = 1; d < n; d++)
+                v = std::min(v, in[x + d]);
+            out[x] = v;
+        }
+    }
+
+    void hmax_scalar(const std::uint8_t* in, std::uint8_t* out, int width, int n)
+    {
+        for (int x = 0; x < width; x++) {
+            std::uint8_t v = in[x];
+            for (int d = 1; d < n; d++)
+                v = std::max(v, in[x + d]);
+            out[x] = v;
+        }
+    }
+
+    void hsum_scalar(const std::uint8_t* in, std::uint8_t* out, int width, int n)
+    {
+        for (int x = 0; x < width; x++) {
+            std::uint8_t v = in[x];
+            for (int d = 1; d < n; d++)
+                v += in[x + d];
+            out[x] = v;
+        }
+    }
+
+    void vmin_scalar(const std::uint8_t* const* rows, int n, std::uint8_t* out, int width)
+    {
+        std::memcpy(out, rows[0], width);
+        for (int i = 1; i < n; i++)
+            for (int x = 0; x < width; x++)
+                out[x] = std::min(out[x], rows[i][x]);
+    }
+
+    void vmax_scalar(const std::uint8_t* const* rows, int n, std::uint8_t* out, int width)
+    {
+        std::memcpy(out, rows[0], width);
+        for (int i = 1; i < n; i++)
+            for (int x = 0; x < width; x++)
+                out[x] = std::max(out[x], rows[i][x]);
+    }
+
+    void vmajority_scalar(const std::uint8_t* const* rows, int n, std::uint8_t* out, int width, int threshold)
+    {
+        for (int x = 0; x < width; x++) {
+            int sum = 0;
+            for (int i = 0; i < n; i++)
+                sum += rows[i][x];
+            out[x] = sum > threshold;
+        }
+    }
+
+#ifdef FUSED_MASK_FILTER_X86
+    // 32 pixels per step; the scalar kernels finish the tail of each row
+
+    __attribute__((target("avx2"))) void hmin_avx2(const std::uint8_t* in, std::uint8_t* out, int width, int n)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+            for (int d = 1; d < n; d++)
+                v = _mm256_min_epu8(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x + d)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+        }
+        hmin_scalar(in + x, out + x, width - x, n);
+    }
+
+    __attribute__((target("avx2"))) void hmax_avx2(const std::uint8_t* in, std::uint8_t* out, int width, int n)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+            for (int d = 1; d < n; d++)
+                v = _mm256_max_epu8(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x + d)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+        }
+        hmax_scalar(in + x, out + x, width - x, n);
+    }
+
+    __attribute__((target("avx2"))) void hsum_avx2(const std::uint8_t* in, std::uint8_t* out, int width, int n)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+            for (int d = 1; d < n; d++)
+                v = _mm256_add_epi8(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x + d)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+        }
+        hsum_scalar(in + x, out + x, width - x, n);
+    }
+
+    __attribute__((target("avx2"))) void vmin_avx2(const std::uint8_t* const* rows, int n, std::uint8_t* out, int width)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[0] + x));
+            for (int i = 1; i < n; i++)
+                v = _mm256_min_epu8(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[i] + x)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+        }
+        for (; x < width; x++) {
+            std::uint8_t v = rows[0][x];
+            for (int i = 1; i < n; i++)
+                v = std::min(v, rows[i][x]);
+            out[x] = v;
+        }
+    }
+
+    __attribute__((target("avx2"))) void vmax_avx2(const std::uint8_t* const* rows, int n, std::uint8_t* out, int width)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[0] + x));
+            for (int i = 1; i < n; i++)
+                v = _mm256_max_epu8(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[i] + x)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+        }
+        for (; x < width; x++) {
+            std::uint8_t v = rows[0][x];
+            for (int i = 1; i < n; i++)
+                v = std::max(v, rows[i][x]);
+            out[x] = v;
+        }
+    }
+
+    __attribute__((target("avx2"))) void vmajority_avx2(const std::uint8_t* const* rows, int n, std::uint8_t* out, int width, int threshold)
+    {
+        // Row sums are horizontal counts <= n, so the total stays below 256 for windows up to 15x15
+        const __m256i limit = _mm256_set1_epi8(static_cast<char>(threshold));
+        const __m256i one = _mm256_set1_epi8(1);
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[0] + x));
+            for (int i = 1; i < n; i++)
+                sum = _mm256_add_epi8(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[i] + x)));
+            // unsigned sum > threshold  <=>  max(sum, threshold + 1) == sum
+            __m256i above = _mm256_cmpeq_epi8(_mm256_max_epu8(sum, _mm256_add_epi8(limit, one)), sum);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_and_si256(above, one));
+        }
+        for (; x < width; x++) {
+            int sum = 0;
+            for (int i = 0; i < n; i++)
+                sum += rows[i][x];
+            out[x] = sum > threshold;
+        }
+    }
+#endif
+
+    const RowKernels& row_kernels()
+    {
+        static const RowKernels kernels = []() {
+            RowKernels k{hmin_scalar, hmax_scalar, hsum_scalar, vmin_scalar, vmax_scalar, vmajority_scalar};
+#ifdef FUSED_MASK_FILTER_X86
+            if (__builtin_cpu_supports("avx2"))
+                k = RowKernels{hmin_avx2, hmax_avx2, hsum_avx2, vmin_avx2, vmax_avx2, vmajority_avx2};
+#endif
+            return k;
+        }();
+        return kernels;
+    }
+} // namespace
+
+FusedMaskFilter::FusedMaskFilter(const MaskFilterSizes& sizes)
+{
+    auto add_stage = [&](Op op, int r) {
+        if (r <= 0)
+            return;
+        Stage stage;
+        stage.op = op;
+        stage.r = r;
+        _stages.push_back(std::move(stage));
+    };
+    // Counts of a majority window have to fit in a byte
+    add_stage(Op::Majority, std::min(sizes.median, 15) / 2);
+    add_stage(Op::Min, sizes.erode / 2);
+    // Repeated dilations with a rectangle are one dilation with a proportionally larger rectangle
+    add_stage(Op::Max, (sizes.dilate / 2) * std::max(0, sizes.dilate_iterations));
+    add_stage(Op::Min, sizes.close_erode / 2);
+}
+
+int FusedMaskFilter::reach() const
+{
+    int reach = 0;
+    for (const auto& stage : _stages)
+        reach += stage.r;
+    return reach;
+}
+
+void FusedMaskFilter::apply(std::uint8_t* data, int width, int height, std::size_t step)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    _data = data;
+    _width = width;
+    _height = height;
+    _step = step;
+
+    for (auto& stage : _stages) {
+        int n = 2 * stage.r + 1;
+        stage.padded.resize(width + 2 * stage.r);
+        stage.ring.resize(n);
+        for (auto& row : stage.ring)
+            row.resize(width);
+        stage.window.resize(n);
+        stage.out.resize(width);
+        stage.next_out = 0;
+    }
+
+    // Shadow removal happens while a row enters the chain; rows are only written back once every stage is done with
+    // them, which is always after they were read, so the filter can work in place
+    std::vector<std::uint8_t>& binary = _binary;
+    binary.resize(width);
+    for (int y = 0; y < height; y++) {
+        const std::uint8_t* src = data + y * step;
+        for (int x = 0; x < width; x++)
+            binary[x] = src[x] > 127;
+        _push(0, y, binary.data());
+    }
+}
+
+void FusedMaskFilter::_push(std::size_t s, int row, const std::uint8_t* values)
+{
+    if (s == _stages.size()) {
+        // End of the chain: back to 0/255
+        std::uint8_t* dst = _data + row * _step;
+        for (int x = 0; x < _width; x++)
+            dst[x] = static_cast<std::uint8_t>(-values[x]);
+        return;
+    }
+
+    Stage& stage = _stages[s];
+    const RowKernels& k = row_kernels();
+    int r = stage.r, n = 2 * r + 1;
+
+    // Border columns: replicated for the median, neutral for erode (1) and dilate (0), like OpenCV's defaults
+    std::uint8_t left = (stage.op == Op::Majority) ? values[0] : (stage.op == Op::Min);
+    std::uint8_t right = (stage.op == Op::Majority) ? values[_width - 1] : (stage.op == Op::Min);
+    std::memset(stage.padded.data(), left, r);
+    std::memcpy(stage.padded.data() + r, values, _width);
+    std::memset(stage.padded.data() + r + _width, right, r);
+
+    std::uint8_t* filtered = stage.ring[row % n].data();
+    if (stage.op == Op::Majority)
+        k.hsum(stage.padded.data(), filtered, _width, n);
+    else if (stage.op == Op::Min)
+        k.hmin(stage.padded.data(), filtered, _width, n);
+    else
+        k.hmax(stage.padded.data(), filtered, _width, n);
+
+    // Every output row whose vertical window is complete can go on to the next stage
+    while (stage.next_out < _height && std::min(stage.next_out + r, _height - 1) <= row)
+        _emit(s, stage.next_out++);
+}
+
+void FusedMaskFilter::_emit(std::size_t s, int row)
+{
+    Stage& stage = _stages[s];
+    const RowKernels& k = row_kernels();
+    int r = stage.r, n = 2 * r + 1;
+
+    int count = 0;
+    if (stage.op == Op::Majority) {
+        // Replicated border rows
+        for (int j = row - r; j <= row + r; j++)
+            stage.window[count++] = stage.ring[std::clamp(j, 0, _height - 1) % n].data();
+        k.vmajority(stage.window.data(), count, stage.out.data(), _width, (n * n) / 2);
+    }
+    else {
+        // Rows outside the mask do not take part
+        for (int j = std::max(0, row - r); j <= std::min(_height - 1, row + r); j++)
+            stage.window[count++] = stage.ring[j % n].data();
+        if (stage.op == Op::Min)
+            k.vmin(stage.window.data(), count, stage.out.data(), _width);
+        else
+            k.vmax(stage.window.data(), count, stage.out.data(), _width);
+    }
+
+    _push(s + 1, row, stage.out.data());
+}
@@ -0,0 +1,55 @@
+#ifndef SEGMENTATION_FUSED_MASK_FILTER_HPP
+#define SEGMENTATION_FUSED_MASK_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structuring element sizes of the mask clean-up chain (odd, square)
+struct MaskFilterSizes {
+    int median = 3; // speckle removal
+    int erode = 3;
+    int dilate = 5;
+    int dilate_iterations = 2; // hole closing
+    int close_erode = 3;
+};
+
+// Shadow removal, median, erode, dilate and erode in one sweep over the mask. Rows stream through a chain of
+// small ring buffers (a few rows per stage), so the mask is read and written once and the working set stays in
+// cache. Results are identical to cv::threshold + cv::medianBlur + cv::erode/cv::dilate with the default borders.
+// Row kernels use AVX2 when the CPU has it and fall back to scalar code otherwise.
+class FusedMaskFilter {
+public:
+    FusedMaskFilter(const MaskFilterSizes& sizes = {});
+
+    // In-place on a CV_8UC1-like buffer (values 0, 127 = shadow, 255); step is the row pitch in bytes
+    void apply(std::uint8_t* data, int width, int height, std::size_t step);
+
+    // How many rows/columns away a mask value can still change the result
+    int reach() const;
+
+protected:
+    enum class Op { Majority, Min, Max };
+
+    // One filter of the chain: horizontal pass on arrival of each row, vertical pass over the last 2r+1 rows
+    struct Stage {
+        Op op;
+        int r;
+        std::vector<std::uint8_t> padded; // input row with r columns of border on each side
+        std::vector<std::vector<std::uint8_t>> ring; // horizontally filtered rows, indexed by row % (2r+1)
+        std::vector<const std::uint8_t*> window;
+        std::vector<std::uint8_t> out;
+        int next_out = 0;
+    };
+
+    void _push(std::size_t s, int row, const std::uint8_t* values);
+    void _emit(std::size_t s, int row);
+
+    std::vector<Stage> _stages;
+    std::vector<std::uint8_t> _binary;
+    int _width = 0, _height = 0;
+    std::uint8_t* _data = nullptr;
+    std::size_t _step = 0;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "i420_segmentation.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+I420Segmentation::I420Segmentation(bool use_chroma) : _use_chroma(use_chroma), _planes(3) {}
+
+void I420Segmentation::apply(cv::BackgroundSubtractor& back_sub, const cv::Mat& i420, const cv::Rect& roi, cv::Mat& mask)
+{
+    int width = i420.cols;
+    int height = i420.rows * 2 / 3;
+    // The Y plane is the first height rows, so the ROI of the plane is a plain sub-matrix
+    cv::Mat luma = i420.rowRange(0, height)(roi);
+    if (!_use_chroma) {
+        back_sub.apply(luma, mask);
+        return;
+    }
+
+    // U and V are width / 2 x height / 2 planes stored back to back after Y
+    cv::Rect chroma_roi(roi.x / 2, roi.y / 2, roi.width / 2, roi.height / 2);
+    cv::Mat u(height / 2, width / 2, CV_8UC1, const_cast<unsigned char*>(i420.ptr(height)));
+    cv::Mat v(height / 2, width / 2, CV_8UC1, const_cast<unsigned char*>(i420.ptr(height)) + (width / 2) * (height / 2));
+    cv::resize(luma, _planes[0], chroma_roi.size(), 0., 0., cv::INTER_AREA);
+    _planes[1] = u(chroma_roi);
+    _planes[2] = v(chroma_roi);
+    cv::merge(_planes, _yuv_half);
+
+    back_sub.apply(_yuv_half, _mask_half);
+    cv::resize(_mask_half, mask, roi.size(), 0., 0., cv::INTER_NEAREST);
+}
+
+cv::Rect align_to_chroma(const cv::Rect& roi)
+{
+    int x0 = roi.x & ~1;
+    int y0 = roi.y & ~1;
+    int x1 = (roi.x + roi.width + 1) & ~1;
+    int y1 = (roi.y + roi.height + 1) & ~1;
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
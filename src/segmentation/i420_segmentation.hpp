@@ -0,0 +1,28 @@
+#ifndef SEGMENTATION_I420_SEGMENTATION_HPP
+#define SEGMENTATION_I420_SEGMENTATION_HPP
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#include <vector>
+
+// Background subtraction on I420 frames without going through BGR. By default only the Y plane of the ROI is used;
+// with chroma, the model runs on a half-resolution Y'UV image (luma downscaled to the chroma grid) and the mask is
+// scaled back up to the ROI.
+class I420Segmentation {
+public:
+    I420Segmentation(bool use_chroma);
+
+    // i420 is CV_8UC1 with height * 3 / 2 rows, roi must be even-aligned (see align_to_chroma). mask gets roi's size.
+    void apply(cv::BackgroundSubtractor& back_sub, const cv::Mat& i420, const cv::Rect& roi, cv::Mat& mask);
+
+protected:
+    bool _use_chroma;
+    std::vector<cv::Mat> _planes;
+    cv::Mat _yuv_half, _mask_half;
+};
+
+// Smallest rectangle with even corners that contains roi, so that it maps onto whole chroma samples
+cv::Rect align_to_chroma(const cv::Rect& roi);
+
+#endif
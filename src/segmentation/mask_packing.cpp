@@ -0,0 +1,58 @@
+#include "mask_packing.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MASK_PACKING_X86 1
+#endif
+
+namespace {
+    void pack_row_scalar(const std::uint8_t* in, std::uint32_t* out, int width)
+    {
+        for (int w = 0; 32 * w < width; w++) {
+            const std::uint8_t* pixels = in + 32 * w;
+            int n = std::min(32, width - 32 * w);
+            std::uint32_t word = 0;
+            for (int b = 0; b < n; b++)
+                word |= std::uint32_t(pixels[b] >> 7) << b;
+            out[w] = word;
+        }
+    }
+
+#ifdef MASK_PACKING_X86
+    // The top bit of every byte is the mask bit, which is exactly what movemask gathers
+    __attribute__((target("avx2"))) void pack_row_avx2(const std::uint8_t* in, std::uint32_t* out, int width)
+    {
+        int x = 0;
+        for (; x + 32 <= width; x += 32)
+            *out++ = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x))));
+        if (x < width)
+            pack_row_scalar(in + x, out, width - x);
+    }
+#endif
+
+    using PackRow = void (*)(const std::uint8_t*, std::uint32_t*, int);
+
+    PackRow pack_row()
+    {
+        static const PackRow kernel = []() {
+            PackRow k = pack_row_scalar;
+#ifdef MASK_PACKING_X86
+            if (__builtin_cpu_supports("avx2"))
+                k = pack_row_avx2;
+#endif
+            return k;
+        }();
+        return kernel;
+    }
+} // namespace
+
+void pack_mask(const cv::Mat& mask, cv::Mat& packed)
+{
+    packed.create(mask.rows, packed_mask_words(mask.cols), CV_32SC1);
+    PackRow kernel = pack_row();
+    for (int y = 0; y < mask.rows; y++)
+        kernel(mask.ptr<std::uint8_t>(y), packed.ptr<std::uint32_t>(y), mask.cols);
+}
@@ -0,0 +1,17 @@
+#ifndef SEGMENTATION_MASK_PACKING_HPP
+#define SEGMENTATION_MASK_PACKING_HPP
+
+#include <opencv2/core.hpp>
+
+// Foreground masks at 1 bit per pixel, the form in which they are handed to the renderer and uploaded to the GPU
+// (unpacked in CombineMask.comp/CombineMaskYUV.comp). Every row is packed into 32-bit words on its own: word i holds
+// pixels 32 * i ... 32 * i + 31, pixel 32 * i + b in bit b. Rows stay top row first. A pixel is set when its mask
+// value is 128 or more, i.e. 255 is foreground and both 0 and 127 (shadow) are background.
+
+// Number of words in a packed row
+inline int packed_mask_words(int width) { return (width + 31) / 32; }
+
+// mask is CV_8UC1. packed gets mask.rows x packed_mask_words(mask.cols), CV_32SC1 (only allocated if it has another size).
+void pack_mask(const cv::Mat& mask, cv::Mat& packed);
+
+#endif
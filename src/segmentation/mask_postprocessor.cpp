@@ -0,0 +1,34 @@
+#include "mask_postprocessor.hpp"
+
+#include <algorithm>
+
+MaskPostProcessor::MaskPostProcessor(ThreadPool* pool, const MaskFilterSizes& sizes) : _filter(sizes), _pool(pool) {}
+
+void MaskPostProcessor::apply(cv::Mat& mask)
+{
+    int reach = std::max(1, _filter.reach());
+    std::size_t num_bands = (_pool != nullptr) ? std::min<std::size_t>(_pool->size(), mask.rows / (4 * reach)) : 1;
+    if (num_bands <= 1) {
+        _filter.apply(mask.data, mask.cols, mask.rows, mask.step);
+        return;
+    }
+
+    _bands.resize(num_bands);
+    // Every band streams through its own copy of the filter state
+    _band_filters.resize(num_bands, _filter);
+    auto core = [&](std::size_t i) { return cv::Range(static_cast<int>(i * mask.rows / num_bands), static_cast<int>((i + 1) * mask.rows / num_bands)); };
+    auto halo = [&](std::size_t i) { cv::Range r = core(i); return cv::Range(std::max(0, r.start - reach), std::min(mask.rows, r.end + reach)); };
+
+    // Every band takes a copy of its rows plus halo first, so that writing the results back cannot race with
+    // a neighbour still reading its halo
+    auto copy_band = [&](std::size_t i) { mask.rowRange(halo(i)).copyTo(_bands[i]); };
+    _pool->parallel_for(num_bands, copy_band);
+
+    auto process_band = [&](std::size_t i) {
+        cv::Mat& band = _bands[i];
+        _band_filters[i].apply(band.data, band.cols, band.rows, band.step);
+        cv::Range r = core(i), h = halo(i);
+        band.rowRange(r.start - h.start, r.end - h.start).copyTo(mask.rowRange(r));
+    };
+    _pool->parallel_for(num_bands, process_band);
+}
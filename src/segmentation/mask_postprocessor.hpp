@@ -0,0 +1,34 @@
+#ifndef SEGMENTATION_MASK_POSTPROCESSOR_HPP
+#define SEGMENTATION_MASK_POSTPROCESSOR_HPP
+
+#include <pipeline/thread_pool.hpp>
+#include <segmentation/fused_mask_filter.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+// Cleans up the raw background subtraction mask: drops shadow pixels (127), removes speckle noise and closes holes.
+// The whole chain runs as one fused sweep (see FusedMaskFilter) and its buffers are kept between calls, so
+// steady-state calls do not allocate.
+// With a thread pool, the mask is cut into horizontal bands that are processed in parallel; every band carries a halo
+// as wide as the reach of the whole filter chain, so the result is identical to processing the mask in one piece.
+class MaskPostProcessor {
+public:
+    MaskPostProcessor(ThreadPool* pool = nullptr, const MaskFilterSizes& sizes = {});
+
+    // In-place. mask must be CV_8UC1 with values 0, 127 (shadow) or 255.
+    void apply(cv::Mat& mask);
+
+    // How far (in pixels) a mask value can influence the result
+    int reach() const { return _filter.reach(); }
+
+protected:
+    FusedMaskFilter _filter;
+
+    ThreadPool* _pool;
+    std::vector<cv::Mat> _bands;
+    std::vector<FusedMaskFilter> _band_filters;
+};
+
+#endif
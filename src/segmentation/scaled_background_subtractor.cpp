@@ -0,0 +1,68 @@
+#include "scaled_background_subtractor.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+
+ScaledBackgroundSubtractor::ScaledBackgroundSubtractor(int factor, cv::Ptr<cv::BackgroundSubtractor> model, int radius, double eps) : _factor(std::max(1, factor)), _model(model), _radius(radius), _eps(eps) {}
+
+void ScaledBackgroundSubtractor::apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate)
+{
+    cv::Mat input = image.getMat();
+    cv::Size small_size(std::max(1, input.cols / _factor), std::max(1, input.rows / _factor));
+
+    cv::resize(input, _small, small_size, 0., 0., cv::INTER_AREA);
+    _model->apply(_small, _small_mask, learningRate);
+
+    // Fast guided filter (He & Sun): the linear coefficients are fitted at low resolution and only applied at full
+    // resolution, so the full-resolution work is two resizes and a multiply-add
+    if (input.channels() == 3) {
+        cv::cvtColor(input, _guide, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(_small, _small_guide, cv::COLOR_BGR2GRAY);
+    }
+    else {
+        _guide = input;
+        _small_guide = _small;
+    }
+    _small_guide.convertTo(_I, CV_32F, 1. / 255.);
+    // Shadows (127) count as background, like in MaskPostProcessor
+    cv::threshold(_small_mask, _small_binary, 127, 1., cv::THRESH_BINARY);
+    _small_binary.convertTo(_p, CV_32F);
+
+    cv::Size window(2 * _radius + 1, 2 * _radius + 1);
+    cv::boxFilter(_I, _mean_I, CV_32F, window);
+    cv::boxFilter(_p, _mean_p, CV_32F, window);
+    cv::multiply(_I, _p, _a);
+    cv::boxFilter(_a, _mean_Ip, CV_32F, window);
+    cv::multiply(_I, _I, _a);
+    cv::boxFilter(_a, _mean_II, CV_32F, window);
+
+    // a = cov(I, p) / (var(I) + eps), b = mean(p) - a * mean(I)
+    cv::multiply(_mean_I, _mean_p, _a);
+    cv::subtract(_mean_Ip, _a, _a);
+    cv::multiply(_mean_I, _mean_I, _b);
+    cv::subtract(_mean_II, _b, _b);
+    cv::add(_b, cv::Scalar(_eps), _b);
+    cv::divide(_a, _b, _a);
+    cv::multiply(_a, _mean_I, _b);
+    cv::subtract(_mean_p, _b, _b);
+    // Averaged coefficients (the mean buffers are free again at this point)
+    cv::boxFilter(_a, _mean_Ip, CV_32F, window);
+    cv::boxFilter(_b, _mean_II, CV_32F, window);
+
+    cv::resize(_mean_Ip, _full_a, input.size(), 0., 0., cv::INTER_LINEAR);
+    cv::resize(_mean_II, _full_b, input.size(), 0., 0., cv::INTER_LINEAR);
+    _guide.convertTo(_full_I, CV_32F, 1. / 255.);
+    cv::multiply(_full_a, _full_I, _q);
+    cv::add(_q, _full_b, _q);
+
+    fgmask.create(input.size(), CV_8UC1);
+    cv::Mat mask = fgmask.getMat();
+    cv::threshold(_q, _q, 0.5, 255., cv::THRESH_BINARY);
+    _q.convertTo(mask, CV_8U);
+}
+
+void ScaledBackgroundSubtractor::getBackgroundImage(cv::OutputArray backgroundImage) const
+{
+    _model->getBackgroundImage(backgroundImage);
+}
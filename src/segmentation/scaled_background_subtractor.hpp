@@ -0,0 +1,31 @@
+#ifndef SEGMENTATION_SCALED_BACKGROUND_SUBTRACTOR_HPP
+#define SEGMENTATION_SCALED_BACKGROUND_SUBTRACTOR_HPP
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+// Runs the background model on a 1/factor downscaled copy of the image and brings the mask back to full resolution
+// with a guided filter steered by the full-resolution image, so silhouettes follow the real edges instead of the
+// blocky low-resolution mask. The output is a binary (0/255) mask of the input size.
+class ScaledBackgroundSubtractor : public cv::BackgroundSubtractor {
+public:
+    // radius (in low-resolution pixels) and eps (on intensities in [0, 1]) are the guided filter parameters
+    ScaledBackgroundSubtractor(int factor, cv::Ptr<cv::BackgroundSubtractor> model, int radius = 2, double eps = 1e-3);
+
+    void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1) override;
+    void getBackgroundImage(cv::OutputArray backgroundImage) const override;
+
+protected:
+    int _factor;
+    cv::Ptr<cv::BackgroundSubtractor> _model;
+    int _radius;
+    double _eps;
+
+    // Reused between frames
+    cv::Mat _small, _small_mask, _small_binary;
+    cv::Mat _guide, _small_guide;
+    cv::Mat _I, _p, _mean_I, _mean_p, _mean_Ip, _mean_II, _a, _b;
+    cv::Mat _full_a, _full_b, _full_I, _q;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "tiled_background_subtractor.hpp"
+
+#include <algorithm>
+
+TiledBackgroundSubtractor::TiledBackgroundSubtractor(int tiles_x, int tiles_y, ThreadPool& pool, Factory factory) : _tiles_x(std::max(1, tiles_x)), _tiles_y(std::max(1, tiles_y)), _pool(pool), _factory(std::move(factory)) {}
+
+void TiledBackgroundSubtractor::_create_tiles(const cv::Size& size)
+{
+    _size = size;
+    _tiles.clear();
+    _models.clear();
+    int tiles_x = std::min(_tiles_x, size.width);
+    int tiles_y = std::min(_tiles_y, size.height);
+    for (int ty = 0; ty < tiles_y; ty++) {
+        int y0 = ty * size.height / tiles_y, y1 = (ty + 1) * size.height / tiles_y;
+        for (int tx = 0; tx < tiles_x; tx++) {
+            int x0 = tx * size.width / tiles_x, x1 = (tx + 1) * size.width / tiles_x;
+            _tiles.emplace_back(x0, y0, x1 - x0, y1 - y0);
+            _models.push_back(_factory());
+        }
+    }
+}
+
+void TiledBackgroundSubtractor::apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate)
+{
+    cv::Mat input = image.getMat();
+    if (input.size() != _size)
+        _create_tiles(input.size());
+
+    fgmask.create(input.size(), CV_8UC1);
+    cv::Mat mask = fgmask.getMat();
+    // Every model writes straight into its part of the output mask
+    auto update_tile = [&](std::size_t i) {
+        cv::Mat tile_mask = mask(_tiles[i]);
+        _models[i]->apply(input(_tiles[i]), tile_mask, learningRate);
+    };
+    _pool.parallel_for(_tiles.size(), update_tile);
+}
+
+void TiledBackgroundSubtractor::getBackgroundImage(cv::OutputArray backgroundImage) const
+{
+    if (_tiles.empty()) {
+        backgroundImage.release();
+        return;
+    }
+    cv::Mat tile_background;
+    _models[0]->getBackgroundImage(tile_background);
+    backgroundImage.create(_size, tile_background.type());
+    cv::Mat background = backgroundImage.getMat();
+    for (std::size_t i = 0; i < _tiles.size(); i++) {
+        _models[i]->getBackgroundImage(tile_background);
+        tile_background.copyTo(background(_tiles[i]));
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef SEGMENTATION_TILED_BACKGROUND_SUBTRACTOR_HPP
+#define SEGMENTATION_TILED_BACKGROUND_SUBTRACTOR_HPP
+
+#include <pipeline/thread_pool.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#include <functional>
+#include <vector>
+
+// Splits the image into a grid of tiles, each with its own background model, and updates the tiles in parallel.
+// MOG2/KNN models are per pixel, so the assembled mask is the same as with one model over the whole image: tile
+// borders leave no seams.
+class TiledBackgroundSubtractor : public cv::BackgroundSubtractor {
+public:
+    using Factory = std::function<cv::Ptr<cv::BackgroundSubtractor>()>;
+
+    TiledBackgroundSubtractor(int tiles_x, int tiles_y, ThreadPool& pool, Factory factory);
+
+    void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1) override;
+    void getBackgroundImage(cv::OutputArray backgroundImage) const override;
+
+protected:
+    // Tiles are laid out on the first frame (and again if the image size changes)
+    void _create_tiles(const cv::Size& size);
+
+    int _tiles_x, _tiles_y;
+    ThreadPool& _pool;
+    Factory _factory;
+    cv::Size _size;
+    std::vector<cv::Rect> _tiles;
+    std::vector<cv::Ptr<cv::BackgroundSubtractor>> _models;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifdef STREAMER_WITH_TORCH
+
+#include "torch_segmenter.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // ImageNet statistics (RGB) the torchvision models are trained with
+    constexpr float mean[3] = {0.485f, 0.456f, 0.406f};
+    constexpr float stddev[3] = {0.229f, 0.224f, 0.225f};
+} // namespace
+
+TorchSegmenter::TorchSegmenter(const StreamerConfiguration& config, bool planar)
+    : ForegroundSegmenter(config.rendering_ROI, planar), _batch_size(std::max<std::size_t>(1, config.torch_batch_size)), _person_class(config.torch_person_class), _channels(3), _single_frame(1), _single_mask(1)
+{
+    if (config.torch_threads > 0)
+        at::set_num_threads(static_cast<int>(config.torch_threads));
+
+    if (config.torch_int8) {
+        // Quantized kernels: fbgemm on x86, qnnpack elsewhere
+        const auto& engines = at::globalContext().supportedQEngines();
+        if (std::find(engines.begin(), engines.end(), at::QEngine::FBGEMM) != engines.end())
+            at::globalContext().setQEngine(at::QEngine::FBGEMM);
+        else if (std::find(engines.begin(), engines.end(), at::QEngine::QNNPACK) != engines.end())
+            at::globalContext().setQEngine(at::QEngine::QNNPACK);
+        else
+            std::cerr << "libtorch has no quantized engine, the int8 model may fail to run" << std::endl;
+    }
+
+    try {
+        _module = torch::jit::load(config.torch_model_path, torch::kCPU);
+        _module.eval();
+        _loaded = true;
+    }
+    catch (const c10::Error& e) {
+        std::cerr << "Could not load segmentation model " << config.torch_model_path << ": " << e.what_without_backtrace() << std::endl;
+        return;
+    }
+
+    _scale = (config.torch_input_scale > 0.) ? std::min(config.torch_input_scale, 1.) : 1.;
+    _resize_input(_roi);
+}
+
+void TorchSegmenter::_resize_input(const cv::Rect& region)
+{
+    _region = region;
+    cv::Size input_size(std::max(1, static_cast<int>(std::lround(region.width * _scale))), std::max(1, static_cast<int>(std::lround(region.height * _scale))));
+    if (input_size == _input_size)
+        return;
+    _input_size = input_size;
+    _input = torch::empty({static_cast<long>(_batch_size), 3, _input_size.height, _input_size.width}, torch::kFloat32);
+}
+
+void TorchSegmenter::set_footprint(const std::vector<cv::Rect>& rects)
+{
+    ForegroundSegmenter::set_footprint(rects);
+    // One forward pass over the bounding box; the footprint is merged already, so there is little waste around it
+    cv::Rect bounds;
+    for (const cv::Rect& rect : rects)
+        bounds |= rect;
+    if (_loaded)
+        _resize_input(rects.empty() ? _roi : bounds + _roi.tl());
+}
+
+void TorchSegmenter::_prepare_input(const cv::Mat& frame, std::size_t slot)
+{
+    const cv::Mat* roi = nullptr;
+    cv::Mat bgr_view;
+    if (_planar) {
+        // Gather the ROI of the three planes into a small I420 image and convert only that
+        int width = frame.cols, height = frame.rows * 2 / 3;
+        cv::Rect chroma_roi(_region.x / 2, _region.y / 2, _region.width / 2, _region.height / 2);
+        cv::Mat u(height / 2, width / 2, CV_8UC1, const_cast<unsigned char*>(frame.ptr(height)));
+        cv::Mat v(height / 2, width / 2, CV_8UC1, const_cast<unsigned char*>(frame.ptr(height)) + (width / 2) * (height / 2));
+        _i420_roi.create(_region.height * 3 / 2, _region.width, CV_8UC1);
+        frame.rowRange(0, height)(_region).copyTo(_i420_roi.rowRange(0, _region.height));
+        // U and V of the small image are (width / 2) x (height / 2) planes stored back to back
+        cv::Mat u_dst(_region.height / 2, _region.width / 2, CV_8UC1, _i420_roi.ptr(_region.height));
+        cv::Mat v_dst(_region.height / 2, _region.width / 2, CV_8UC1, _i420_roi.ptr(_region.height) + (_region.width / 2) * (_region.height / 2));
+        u(chroma_roi).copyTo(u_dst);
+        v(chroma_roi).copyTo(v_dst);
+        cv::cvtColor(_i420_roi, _bgr_roi, cv::COLOR_YUV2BGR_I420);
+        roi = &_bgr_roi;
+    }
+    else {
+        bgr_view = frame(_region);
+        roi = &bgr_view;
+    }
+
+    cv::resize(*roi, _resized, _input_size, 0., 0., cv::INTER_AREA);
+    _resized.convertTo(_float, CV_32FC3, 1. / 255.);
+    cv::split(_float, _channels);
+
+    // Normalize straight into the channel planes of the input tensor (BGR -> RGB)
+    float* base = _input.data_ptr<float>() + slot * 3 * _input_size.area();
+    for (int c = 0; c < 3; c++) {
+        cv::Mat plane(_input_size, CV_32FC1, base + c * _input_size.area());
+        _channels[2 - c].convertTo(plane, CV_32F, 1. / stddev[c], -mean[c] / stddev[c]);
+    }
+}
+
+void TorchSegmenter::apply(const cv::Mat& frame, cv::Mat& mask)
+{
+    _single_frame[0] = &frame;
+    _single_mask[0] = &mask;
+    apply_batch(_single_frame, _single_mask);
+}
+
+void TorchSegmenter::apply_batch(const std::vector<const cv::Mat*>& frames, const std::vector<cv::Mat*>& masks)
+{
+    // Larger batches than configured are split
+    for (std::size_t begin = 0; begin < frames.size(); begin += _batch_size) {
+        std::size_t count = std::min(_batch_size, frames.size() - begin);
+        for (std::size_t i = 0; i < count; i++)
+            _prepare_input(*frames[begin + i], i);
+
+        torch::NoGradGuard no_grad;
+        torch::jit::IValue output = _module.forward({_input.narrow(0, 0, static_cast<long>(count))});
+        torch::Tensor logits;
+        if (output.isTensor())
+            logits = output.toTensor();
+        else if (output.isTuple())
+            logits = output.toTuple()->elements()[0].toTensor();
+        else
+            logits = output.toGenericDict().at("out").toTensor();
+
+        torch::Tensor foreground = (logits.size(1) == 1) ? logits.select(1, 0).gt(0.) : logits.argmax(1).eq(_person_class);
+        foreground = foreground.to(torch::kUInt8).mul_(255).contiguous();
+
+        // Back to the region size; bilinear + threshold gives smoother edges than nearest neighbour
+        int out_height = static_cast<int>(foreground.size(1)), out_width = static_cast<int>(foreground.size(2));
+        for (std::size_t i = 0; i < count; i++) {
+            cv::Mat small(out_height, out_width, CV_8UC1, foreground.data_ptr<unsigned char>() + i * out_height * out_width);
+            cv::Mat& mask = *masks[begin + i];
+            mask.create(_roi.size(), CV_8UC1);
+            cv::Mat region_mask = mask(_region - _roi.tl());
+            cv::resize(small, region_mask, _region.size(), 0., 0., cv::INTER_LINEAR);
+            cv::threshold(region_mask, region_mask, 127, 255, cv::THRESH_BINARY);
+        }
+    }
+}
+
+#endif
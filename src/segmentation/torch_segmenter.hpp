@@ -0,0 +1,60 @@
+#ifndef SEGMENTATION_TORCH_SEGMENTER_HPP
+#define SEGMENTATION_TORCH_SEGMENTER_HPP
+
+// Only available when libtorch was found at configure time
+#ifdef STREAMER_WITH_TORCH
+
+#include <segmentation/foreground_segmenter.hpp>
+#include <utils/utils.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <torch/script.h>
+
+#include <cstddef>
+#include <vector>
+
+// Person segmentation with a TorchScript network on the CPU. Frames are batched (config.torch_batch_size) so that one
+// forward pass covers several queued frames, and libtorch runs it on config.torch_threads intra-op threads.
+// The network gets an ImageNet-normalized RGB batch at config.torch_input_scale times the ROI size and has to return
+// logits, either one channel (foreground > 0) or one channel per class (config.torch_person_class is foreground),
+// as a tensor, a tuple starting with it or a dict with an "out" entry (torchvision segmentation models).
+// An int8-quantized model is loaded the same way; config.torch_int8 selects the quantized engine for it.
+class TorchSegmenter : public ForegroundSegmenter {
+public:
+    TorchSegmenter(const StreamerConfiguration& config, bool planar);
+
+    bool is_loaded() const { return _loaded; }
+
+    void apply(const cv::Mat& frame, cv::Mat& mask) override;
+    std::size_t batch_size() const override { return _batch_size; }
+    void apply_batch(const std::vector<const cv::Mat*>& frames, const std::vector<cv::Mat*>& masks) override;
+    // The network runs on the bounding box of the footprint
+    void set_footprint(const std::vector<cv::Rect>& rects) override;
+    // Stateless per frame, there is no background to learn
+    void warm_start(const BackgroundSnapshot&, const cv::Size&, std::size_t) override {}
+
+protected:
+    // Reallocates the input batch when the size of the region changes
+    void _resize_input(const cv::Rect& region);
+    // Writes the normalized region of frame into slot of the input batch
+    void _prepare_input(const cv::Mat& frame, std::size_t slot);
+
+    torch::jit::script::Module _module;
+    bool _loaded = false;
+    std::size_t _batch_size;
+    int _person_class;
+    double _scale;
+    cv::Rect _region; // part of the frame fed to the network: the ROI or the bounding box of the footprint
+    cv::Size _input_size;
+    // Input batch, kept between calls and filled in place
+    torch::Tensor _input;
+    cv::Mat _i420_roi, _bgr_roi, _resized, _float;
+    std::vector<cv::Mat> _channels;
+    std::vector<const cv::Mat*> _single_frame;
+    std::vector<cv::Mat*> _single_mask;
+};
+
+#endif
+
+#endif
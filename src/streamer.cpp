@@ -1,6 +1,21 @@
 #include <opengl_rendering/openglrenderer.hpp>
 #include <opengl_rendering/windowless_contexts.hpp>
+#include <pipeline/buffer_pool.hpp>
+#include <pipeline/frame_packet.hpp>
+#include <pipeline/live_schedule.hpp>
+#include <pipeline/overlay_footprint.hpp>
+#include <pipeline/spsc_queue.hpp>
+#include <pipeline/thread_pool.hpp>
+#include <segmentation/background_snapshot.hpp>
+#include <segmentation/foreground_segmenter.hpp>
+#include <segmentation/i420_segmentation.hpp>
+#include <segmentation/mask_packing.hpp>
+#include <segmentation/mask_postprocessor.hpp>
+#include <utils/allocation_counter.hpp>
+#include <utils/timeline.hpp>
 #include <utils/utils.hpp>
+#include <video_io/frame_io.hpp>
+#include <video_io/smart_render.hpp>
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
@@ -11,12 +26,23 @@
 // Corrade
 #include <Corrade/Utility/Debug.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <signal.h>
+#include <vector>
 
 #include <thread>
 
+namespace fs = std::filesystem;
+
 #include <GLFW/glfw3.h>
 
 #include <imgui/imgui.h>
@@ -24,7 +50,8 @@
 #include <imgui/imgui_impl_opengl3.h>
 
 namespace global {
-    bool stop_video = false;
+    // Read by every pipeline stage thread, written by the SIGINT handler
+    std::atomic<bool> stop_video{false};
     bool applied = false;
 
     StreamerConfiguration config;
@@ -38,86 +65,979 @@ namespace global {
     ShotData shot_data;
     SharedShotData filtered_shot_data;
 
+    // Display settings edited in the GUI before they are applied
     HackyData hackyData;
+
+    // Headless mode: no GUI, filters are applied from a scripted timeline
+    bool headless = false;
+    Timeline timeline;
+    // Offline mode: process the input in parallel time chunks
+    bool offline = false;
 } // namespace global
 
+// Publishes a new filter selection to the renderer that draws from shots (GUI Apply button or headless timeline)
+void apply_filter(const Filter& filter, int side, SharedShotData& shots)
+{
+    shots.mutex.lock();
+    shots.display.side = side;
+    shots.display.timePeriod = filter.quarter;
+    shots.display.displayTab = filter.displayTab;
+    shots.display.displayShots = filter.displayShots;
+    shots.display.displayCourtStats = filter.displayCourtStats;
+    shots.display.displayLogoMiddle = filter.displayLogoMiddle;
+    shots.display.displayRegions = filter.displayRegions;
+    shots.display.team = filter.team;
+    shots.display.player = filter.player;
+    shots.display.shotType = filter.shotType;
+    std::vector<ShotDataEntry> filtered_data = filter_shot_data(global::shot_data, filter);
+    Stats stats = get_stats(global::shot_data, filter);
+    shots.shot_data = filtered_data;
+    shots.stats = stats;
+    shots.updated.store(true);
+    shots.mutex.unlock();
+}
+
+// Removes every overlay (GUI Clear button or headless timeline)
+void clear_filter(SharedShotData& shots)
+{
+    shots.mutex.lock();
+    shots.display.reset();
+    shots.shot_data.clear();
+    shots.stats.reset();
+    shots.updated.store(true);
+    shots.mutex.unlock();
+}
+
+void apply_timeline_entry(const TimelineEntry& entry, SharedShotData& shots)
+{
+    if (entry.clear) {
+        clear_filter(shots);
+        return;
+    }
+    apply_filter(entry.filter, entry.side, shots);
+}
+
+MaskFilterSizes mask_filter_sizes()
+{
+    MaskFilterSizes sizes;
+    sizes.median = global::config.mask_median_size;
+    sizes.erode = global::config.mask_erode_size;
+    sizes.dilate = global::config.mask_dilate_size;
+    sizes.dilate_iterations = global::config.mask_dilate_iterations;
+    sizes.close_erode = global::config.mask_close_erode_size;
+    return sizes;
+}
+
+// Extra output of a multi-feed run (see FeedProfile)
+struct Feed {
+    FeedProfile profile;
+    SharedShotData shots;
+    std::unique_ptr<OpenGLRenderer> renderer;
+    std::unique_ptr<FrameSink> output;
+    std::unique_ptr<SPSCQueue<FramePacket>> rendered_frames;
+    std::unique_ptr<BufferPool> frame_pool;
+    std::thread encode_thread;
+};
+
+// Rung of the ABR ladder: gets the composited main frame, scales it into its own buffer and encodes it
+struct Rendition {
+    RenditionProfile profile;
+    std::unique_ptr<FrameSink> output;
+    std::unique_ptr<SPSCQueue<FramePacket>> frames;
+    // Index of every frame the rung is done reading, so that the main encoder can recycle it
+    std::unique_ptr<SPSCQueue<std::size_t>> scaled;
+    cv::Mat buffer;
+    std::thread encode_thread;
+};
+
 int streamer()
 {
 
-    // Open input video file
-    cv::VideoCapture input_video(global::config.input_video_url);
-    if (!input_video.isOpened()) {
+    // Open input video (file, pipe or FIFO depending on io.input_format)
+    std::unique_ptr<FrameSource> input_video = open_frame_source(global::config);
+    if (!input_video->is_opened()) {
         std::cerr << "Could not open input video file" << std::endl;
         return -1;
     }
 
-    // Get input video file properties
-    int frame_width = input_video.get(cv::CAP_PROP_FRAME_WIDTH);
-    int frame_height = input_video.get(cv::CAP_PROP_FRAME_HEIGHT);
-    double fps = input_video.get(cv::CAP_PROP_FPS); // video frame rate
-    std::size_t total_frames = input_video.get(cv::CAP_PROP_FRAME_COUNT); // total number of frames
+    // Get input video properties
+    int frame_width = input_video->width();
+    int frame_height = input_video->height();
+    double fps = input_video->fps(); // video frame rate
+    std::size_t total_frames = input_video->total_frames(); // total number of frames (0 if unknown)
 
-    // Create output video file
-    cv::VideoWriter output_video(global::config.output_video_url, cv::VideoWriter::fourcc('a', 'v', 'c', '1'), fps, cv::Size(frame_width, frame_height));
-    if (!output_video.isOpened()) {
+    // Timeline entries given as timestamps need the frame rate to be mapped to frames
+    resolve_timeline(global::timeline, fps);
+
+    // Create output video (file, pipe or FIFO depending on io.output_format)
+    std::unique_ptr<FrameSink> output_video = open_frame_sink(global::config, frame_width, frame_height, fps);
+    if (!output_video->is_opened()) {
         std::cerr << "Could not create output video file" << std::endl;
         return -1;
     }
 
-    // Initialize object for background subtraction
-    cv::Ptr<cv::BackgroundSubtractor> back_sub = cv::createBackgroundSubtractorMOG2(global::config.bg_sub_history, global::config.distance_threshold, global::config.detect_shadows);
+    // Initialize the foreground segmenter (config background_subtraction.segmenter)
+    // With segmentation threads, the background model tiles and the mask post-processing run in parallel on the pool
+    // (the segmentation thread takes part in the work)
+    std::size_t segmentation_threads = global::config.segmentation_threads;
+    if (segmentation_threads == 0)
+        segmentation_threads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool segmentation_pool(segmentation_threads);
+    bool planar = (global::config.pixel_format == "i420");
+    std::unique_ptr<ForegroundSegmenter> segmenter = create_foreground_segmenter(global::config, segmentation_pool, planar);
+    std::size_t segmentation_batch = segmenter->batch_size();
+
+    // Background snapshot: start from what the last run at this venue learnt, and keep learning for the next one.
+    // The GPU model is warm-started on the render thread once its GL objects exist; it does not write snapshots.
+    std::string snapshot_path = background_snapshot_path(global::config, planar);
+    BackgroundSnapshot background_snapshot;
+    bool warm_start = load_background_snapshot(snapshot_path, global::config.rendering_ROI.size(), planar, background_snapshot);
+    BackgroundStatistics background_statistics(global::config.rendering_ROI, planar);
+    if (warm_start && !global::config.gpu_segmentation) {
+        segmenter->warm_start(background_snapshot, cv::Size(frame_width, frame_height), global::config.snapshot_warm_frames);
+        background_statistics.seed(background_snapshot);
+    }
 
     // Set maximum number of GL contexts
     GlobalGLContexts::instance().set_max_contexts(1, 1);
     // Initialize an OpenGLRenderer object - class that is responsible for rendering graphics with OpenGL
     std::unique_ptr<OpenGLRenderer> opengl_renderer = std::make_unique<OpenGLRenderer>(global::config);
 
-    // Create GL contexts
-    get_gl_context_select_with_sleep_and_creation_check(glcontext, 20, true, opengl_renderer->get_gpu_id());
-    // Initialize OpenGL resources for rendering with OpenGLRenderer
-    opengl_renderer->opengl_init(global::config);
+    // Each stage runs on its own thread and hands frames to the next one through a bounded queue:
+    // decode -> segmentation -> render -> encode. Throughput is then bounded by the slowest stage.
+    SPSCQueue<FramePacket> decoded_frames(global::config.queue_depth);
+    SPSCQueue<FramePacket> segmented_frames(global::config.queue_depth);
+    SPSCQueue<FramePacket> rendered_frames(global::config.queue_depth);
+    std::vector<QueueOccupancy> occupancy{{"decode->segment", decoded_frames.capacity()}, {"segment->render", segmented_frames.capacity()}, {"render->encode", rendered_frames.capacity()}};
+
+    // Frame and mask buffers are recycled: decode/segmentation acquire them, the encode stage returns them.
+    // Enough buffers for every queue slot plus the ones each stage is working on (the segmentation stage holds a
+    // whole batch).
+    std::size_t buffers_in_flight = 3 * global::config.queue_depth + 4 + segmentation_batch;
+    // I420 frames are single-channel with the U and V planes below Y
+    cv::Size frame_buffer_size = planar ? cv::Size(frame_width, frame_height * 3 / 2) : cv::Size(frame_width, frame_height);
+    int frame_buffer_type = planar ? CV_8UC1 : CV_8UC3;
+    BufferPool frame_pool(buffers_in_flight, frame_buffer_size, frame_buffer_type);
+    // Masks travel bit-packed (see pack_mask); the byte masks never leave the segmentation stage
+    BufferPool mask_pool(buffers_in_flight, cv::Size(packed_mask_words(global::config.rendering_ROI.width), global::config.rendering_ROI.height), CV_32SC1);
+
+    auto render_frame = [planar](OpenGLRenderer& renderer, FramePacket& packet, SharedShotData& shots) {
+        if (planar)
+            renderer.render_i420(packet.frame, packet.foreground_mask, shots);
+        else
+            renderer.render(packet.frame, packet.foreground_mask, shots);
+    };
+    // GPU segmentation: the model runs on the render thread, on the ROI uploaded for compositing anyway
+    bool gpu_segmentation = global::config.gpu_segmentation;
+    auto segment_frame = [planar](OpenGLRenderer& renderer, FramePacket& packet) {
+        if (planar)
+            renderer.segment_i420(packet.frame);
+        else
+            renderer.segment(packet.frame);
+    };
+
+    // Overlay footprint: the render stage publishes where overlays are drawn (over all feeds) and the segmentation
+    // stage only segments and cleans up there
+    bool footprint_only = global::config.footprint_only;
+    OverlayFootprint overlay_footprint;
+    cv::Rect roi_bounds(cv::Point(), global::config.rendering_ROI.size());
 
-    // Read frames from input video and write to output video
+    // Multi-feed: every extra feed has its own overlay selection, renderer, output and encode thread, while decode
+    // and segmentation are shared. The main output keeps following the GUI/timeline.
+    std::vector<std::unique_ptr<Feed>> feeds;
+    for (const auto& profile : global::config.feeds) {
+        auto feed = std::make_unique<Feed>();
+        feed->profile = profile;
+        StreamerConfiguration feed_config = global::config;
+        feed_config.output_video_url = profile.output_video_url;
+        feed->output = open_frame_sink(feed_config, frame_width, frame_height, fps);
+        if (!feed->output->is_opened()) {
+            std::cerr << "Could not create output of feed '" << profile.name << "'" << std::endl;
+            return -1;
+        }
+        feed->renderer = std::make_unique<OpenGLRenderer>(global::config);
+        feed->rendered_frames = std::make_unique<SPSCQueue<FramePacket>>(global::config.queue_depth);
+        feed->frame_pool = std::make_unique<BufferPool>(global::config.queue_depth + 3, frame_buffer_size, frame_buffer_type);
+        apply_filter(profile.filter, profile.side, feed->shots);
+        feeds.push_back(std::move(feed));
+    }
+
+    // Live mode: every frame gets a deadline derived from the input frame rate. Stages predict from their running
+    // costs whether a frame can still make it, and apply the late policy if not.
+    bool live = global::config.live;
+    LatePolicy late_policy = late_policy_from_string(global::config.live_late_policy);
+    FrameSchedule schedule(fps, global::config.live_latency_budget_ms);
+    StageCost segmentation_cost, render_cost;
+    LiveCounters live_counters;
+
+    // Read frames from input video
     // We assume that the input video is undistorted already
-    cv::Mat frame, foreground_mask;
-    std::size_t frame_counter = 0;
-    //int i=0;
-    while (input_video.read(frame) && !global::stop_video) {
+    std::thread decode_thread([&]() {
+        std::size_t frame_index = 0;
+        while (!global::stop_video) {
+            // Files are paced at their frame rate; for real-time sources the read itself blocks until the frame is there
+            if (live && schedule.started())
+                std::this_thread::sleep_until(schedule.arrival(frame_index));
+            FramePacket packet;
+            packet.frame = frame_pool.acquire();
+            if (!(planar ? input_video->read_i420(packet.frame) : input_video->read(packet.frame)))
+                break;
+            // Deadlines count from when the frame was actually read
+            packet.deadline = schedule.arrived(frame_index);
+            packet.index = frame_index++;
+            decoded_frames.push(std::move(packet));
+        }
+        // On EOF or Ctrl+C, the marker lets the downstream stages drain the frames already in flight and exit
+        decoded_frames.push(FramePacket::end_of_stream_marker());
+    });
+
+    std::thread segmentation_thread([&]() {
+        MaskPostProcessor mask_postprocessor(&segmentation_pool, mask_filter_sizes());
+        cv::Mat previous_mask; // for the reuse_mask policy
+        // Batched segmenters get several frames per call; the vectors keep their capacity between batches.
+        // Segmentation writes into the byte masks, which are packed into the packets' masks afterwards.
+        std::vector<FramePacket> batch;
+        std::vector<const cv::Mat*> batch_frames;
+        std::vector<cv::Mat*> batch_masks, batch_packed_masks;
+        std::vector<cv::Mat> byte_masks(segmentation_batch);
+        batch.reserve(segmentation_batch);
+        batch_frames.reserve(segmentation_batch);
+        batch_masks.reserve(segmentation_batch);
+        batch_packed_masks.reserve(segmentation_batch);
+        // Footprint grown by the reach of the clean-up, so that the mask is exact inside the footprint itself
+        std::vector<cv::Rect> footprint, padded_footprint;
+        std::size_t footprint_version = 0;
+        std::size_t snapshot_frames = 0;
+        BackgroundSnapshot saved_snapshot;
+        FramePacket packet;
+        bool end_of_stream = false;
+        while (!end_of_stream) {
+            batch.clear();
+            while (batch.size() < segmentation_batch) {
+                decoded_frames.pop(packet);
+                if (packet.end_of_stream) {
+                    end_of_stream = true;
+                    break;
+                }
+                if (gpu_segmentation) {
+                    // No CPU mask; the render stage computes it on the GPU
+                    segmented_frames.push(std::move(packet));
+                    continue;
+                }
+                batch.push_back(std::move(packet));
+            }
+            if (batch.empty())
+                continue;
+
+            if (footprint_only) {
+                std::size_t version = overlay_footprint.snapshot(footprint, footprint_version);
+                if (version != footprint_version) {
+                    footprint_version = version;
+                    padded_footprint = footprint;
+                    pad_footprint(padded_footprint, mask_postprocessor.reach(), roi_bounds);
+                    segmenter->set_footprint(padded_footprint);
+                }
+            }
+
+            LiveClock::time_point start = LiveClock::now();
+            batch_frames.clear();
+            batch_masks.clear();
+            batch_packed_masks.clear();
+            for (auto& p : batch) {
+                p.foreground_mask = mask_pool.acquire();
+                if (live && start + segmentation_cost.estimate() + render_cost.estimate() > p.deadline) {
+                    p.late = true;
+                }
+
+                if (p.late && late_policy == LatePolicy::ReuseMask && !previous_mask.empty()) {
+                    previous_mask.copyTo(p.foreground_mask);
+                    live_counters.reused_masks++;
+                }
+                else if (p.late && (late_policy == LatePolicy::Drop || late_policy == LatePolicy::PassThrough)) {
+                    // Written without overlay or not at all: segmenting it would only make the next frames late too
+                    p.foreground_mask.setTo(0);
+                }
+                else if (!footprint_only || !padded_footprint.empty()) {
+                    batch_frames.push_back(&p.frame);
+                    batch_masks.push_back(&byte_masks[batch_masks.size()]);
+                    batch_packed_masks.push_back(&p.foreground_mask);
+                }
+                else {
+                    // Empty footprint: nothing is segmented. Overlays applied before the new footprint reaches this
+                    // stage are drawn over everything instead of being cut by a recycled mask buffer.
+                    p.foreground_mask.setTo(0);
+                }
+            }
+
+            if (!batch_frames.empty()) {
+                // Perform background subtraction
+                segmenter->apply_batch(batch_frames, batch_masks);
+                // Post-process foreground masks
+                for (cv::Mat* mask : batch_masks) {
+                    if (!footprint_only) {
+                        mask_postprocessor.apply(*mask);
+                        continue;
+                    }
+                    for (const cv::Rect& rect : padded_footprint) {
+                        cv::Mat mask_rect = (*mask)(rect);
+                        mask_postprocessor.apply(mask_rect);
+                    }
+                    // Until the new footprint reaches this stage, overlays may cover parts that were not segmented;
+                    // they are drawn over everything there instead of being cut by a stale mask
+                    clear_outside_footprint(*mask, padded_footprint);
+                }
+                for (std::size_t i = 0; i < batch_masks.size(); i++)
+                    pack_mask(*batch_masks[i], *batch_packed_masks[i]);
+
+                if (!snapshot_path.empty()) {
+                    // The masks are only valid inside the footprint (empty without footprint_only: the whole ROI)
+                    for (std::size_t i = 0; i < batch_frames.size(); i++)
+                        background_statistics.update(*batch_frames[i], *batch_masks[i], padded_footprint);
+                    snapshot_frames += batch_frames.size();
+                    if (global::config.snapshot_interval > 0 && snapshot_frames >= global::config.snapshot_interval) {
+                        snapshot_frames = 0;
+                        background_statistics.snapshot(saved_snapshot);
+                        save_background_snapshot(snapshot_path, saved_snapshot);
+                    }
+                }
+
+                if (live) {
+                    // Cost per frame, so that the estimate does not depend on the batch size
+                    segmentation_cost.add((LiveClock::now() - start) / static_cast<long>(batch_frames.size()));
+                    if (late_policy == LatePolicy::ReuseMask)
+                        batch_packed_masks.back()->copyTo(previous_mask);
+                }
+            }
+
+            for (auto& p : batch)
+                segmented_frames.push(std::move(p));
+        }
+        segmented_frames.push(std::move(packet));
+
+        if (!background_statistics.empty()) {
+            background_statistics.snapshot(saved_snapshot);
+            save_background_snapshot(snapshot_path, saved_snapshot);
+        }
+    });
+
+    // Render stage throughput and the time frames spend between submission to the renderers and completion, for the
+    // report at exit (with transfer_depth > 1 the two overlap across frames)
+    std::size_t transfer_depth = std::max<std::size_t>(1, global::config.transfer_depth);
+    std::size_t render_frames = 0;
+    double render_seconds = 0., transfer_latency_ms = 0.;
+
+    // GL contexts are bound to a thread, so everything GL-related (init, render, destroy) lives in the render stage
+    std::thread render_thread([&]() {
+        // Create GL contexts
+        get_gl_context_select_with_sleep_and_creation_check(glcontext, 20, true, opengl_renderer->get_gpu_id());
+        // Initialize OpenGL resources for rendering with OpenGLRenderer
+        opengl_renderer->opengl_init(global::config);
+        // Feed renderers share the context; each owns its own GL objects
+        for (auto& feed : feeds) {
+            // One GPU model for all feeds, owned by the main renderer
+            if (gpu_segmentation)
+                feed->renderer->share_mask(*opengl_renderer);
+            feed->renderer->opengl_init(global::config);
+        }
+        if (gpu_segmentation && warm_start) {
+            cv::Mat frame = cv::Mat::zeros(frame_buffer_size, frame_buffer_type);
+            cv::RNG rng;
+            cv::Rect whole(cv::Point(), global::config.rendering_ROI.size());
+            for (std::size_t i = 0; i < global::config.snapshot_warm_frames; i++) {
+                synthesize_background(background_snapshot, global::config.rendering_ROI, whole, planar, rng, frame);
+                if (planar)
+                    opengl_renderer->segment_i420(frame);
+                else
+                    opengl_renderer->segment(frame);
+            }
+        }
+
+        // Frames submitted to the renderers whose transfers may still be running, oldest first. Each renderer
+        // completes its frames in submission order, so the oldest entry is finished on every renderer that rendered
+        // it and then handed to the encoders.
+        struct InFlightFrame {
+            FramePacket packet;
+            std::vector<FramePacket> feed_packets;
+            bool rendered = false;
+            LiveClock::time_point submitted;
+        };
+        std::deque<InFlightFrame> in_flight;
+        auto retire_frame = [&]() {
+            InFlightFrame& oldest = in_flight.front();
+            if (oldest.rendered) {
+                for (auto& feed : feeds)
+                    feed->renderer->finish_render();
+                opengl_renderer->finish_render();
+            }
+            transfer_latency_ms += std::chrono::duration<double, std::milli>(LiveClock::now() - oldest.submitted).count();
+            render_frames++;
+            for (std::size_t i = 0; i < feeds.size(); i++)
+                feeds[i]->rendered_frames->push(std::move(oldest.feed_packets[i]));
+            rendered_frames.push(std::move(oldest.packet));
+            in_flight.pop_front();
+        };
+
+        std::size_t next_timeline_entry = 0;
+        std::vector<cv::Rect> footprint_union;
+        std::size_t published_footprint_version = 0;
+        FramePacket packet;
+        LiveClock::time_point render_begin = LiveClock::now();
+        while (true) {
+            segmented_frames.pop(packet);
+            if (packet.end_of_stream)
+                break;
+
+            // Timeline entries are applied right before their frame is rendered, so they take effect on that exact frame
+            while (next_timeline_entry < global::timeline.size() && global::timeline[next_timeline_entry].frame <= static_cast<long>(packet.index)) {
+                apply_timeline_entry(global::timeline[next_timeline_entry++], global::filtered_shot_data);
+            }
+
+            LiveClock::time_point start = LiveClock::now();
+            if (live && start + render_cost.estimate() > packet.deadline) {
+                packet.late = true;
+            }
+
+            bool render_overlays = true;
+            if (packet.late && late_policy == LatePolicy::Drop) {
+                packet.drop = true;
+                render_overlays = false;
+            }
+            else if (packet.late && late_policy == LatePolicy::PassThrough) {
+                // On air, an on-time frame without overlay beats a late one with it
+                live_counters.passed_through++;
+                render_overlays = false;
+            }
+
+            if (footprint_only && opengl_renderer->is_opengl_init()) {
+                // Overlays first, so that the footprint is current for GPU segmentation and reaches the segmentation
+                // stage as soon as it changes. The versions only grow, so their sum changes whenever one of them does.
+                opengl_renderer->update_overlays(global::filtered_shot_data);
+                std::size_t version = opengl_renderer->footprint_version();
+                for (auto& feed : feeds) {
+                    feed->renderer->update_overlays(feed->shots);
+                    version += feed->renderer->footprint_version();
+                }
+                if (version != published_footprint_version) {
+                    published_footprint_version = version;
+                    footprint_union = opengl_renderer->footprint();
+                    for (auto& feed : feeds)
+                        footprint_union.insert(footprint_union.end(), feed->renderer->footprint().begin(), feed->renderer->footprint().end());
+                    merge_footprint(footprint_union, roi_bounds);
+                    overlay_footprint.publish(footprint_union);
+                    opengl_renderer->set_segmentation_footprint(footprint_union);
+                }
+            }
+
+            // The model learns from every frame that is written, overlays or not
+            if (gpu_segmentation && !packet.drop)
+                segment_frame(*opengl_renderer, packet);
+
+            // Feeds first, while packet.frame is still the clean input frame
+            InFlightFrame submitted;
+            submitted.submitted = start;
+            submitted.rendered = render_overlays;
+            for (auto& feed : feeds) {
+                FramePacket feed_packet;
+                feed_packet.index = packet.index;
+                feed_packet.drop = packet.drop;
+                if (!packet.drop) {
+                    feed_packet.frame = feed->frame_pool->acquire();
+                    packet.frame.copyTo(feed_packet.frame);
+                    feed_packet.foreground_mask = packet.foreground_mask;
+                    if (render_overlays)
+                        render_frame(*feed->renderer, feed_packet, feed->shots);
+                    feed_packet.foreground_mask = cv::Mat(); // owned by the main packet
+                }
+                submitted.feed_packets.push_back(std::move(feed_packet));
+            }
+
+            if (render_overlays) {
+                // Render logos
+                render_frame(*opengl_renderer, packet, global::filtered_shot_data);
+                if (live)
+                    render_cost.add(LiveClock::now() - start);
+            }
+
+            submitted.packet = std::move(packet);
+            in_flight.push_back(std::move(submitted));
+            while (in_flight.size() >= transfer_depth)
+                retire_frame();
+        }
+        while (!in_flight.empty())
+            retire_frame();
+        render_seconds = std::chrono::duration<double>(LiveClock::now() - render_begin).count();
+        rendered_frames.push(std::move(packet));
+        for (auto& feed : feeds) {
+            feed->rendered_frames->push(FramePacket::end_of_stream_marker());
+        }
+
+        // Clear opengl resources
+        for (auto& feed : feeds) {
+            feed->renderer->opengl_destroy();
+        }
+        opengl_renderer->opengl_destroy();
+
+        // release GL contexts
+        release_gl_context(glcontext);
+    });
+
+    // ABR ladder: the main output is composited once, every rung is scaled and encoded on its own thread
+    std::vector<std::unique_ptr<Rendition>> renditions;
+    for (const auto& profile : global::config.renditions) {
+        auto rendition = std::make_unique<Rendition>();
+        rendition->profile = profile;
+        // 4:2:0 needs even dimensions
+        rendition->profile.width &= ~1;
+        rendition->profile.height &= ~1;
+        StreamerConfiguration rendition_config = global::config;
+        rendition_config.output_video_url = profile.output_video_url;
+        rendition->output = open_frame_sink(rendition_config, rendition->profile.width, rendition->profile.height, fps);
+        if (rendition->profile.width <= 0 || rendition->profile.height <= 0 || !rendition->output->is_opened()) {
+            std::cerr << "Could not create rendition '" << profile.name << "'. Skipping it." << std::endl;
+            continue;
+        }
+        rendition->frames = std::make_unique<SPSCQueue<FramePacket>>(global::config.queue_depth);
+        rendition->scaled = std::make_unique<SPSCQueue<std::size_t>>(global::config.queue_depth);
+        renditions.push_back(std::move(rendition));
+    }
+    for (auto& rendition : renditions) {
+        rendition->encode_thread = std::thread([&, r = rendition.get()]() {
+            cv::Size size(r->profile.width, r->profile.height);
+            FramePacket packet;
+            while (true) {
+                r->frames->pop(packet);
+                if (packet.end_of_stream)
+                    break;
+                scale_frame(packet.frame, r->buffer, size, planar);
+                // The main encoder may recycle the frame as soon as every rung has scaled it
+                packet.frame = cv::Mat();
+                r->scaled->push(std::size_t(packet.index));
+                if (!(planar ? r->output->write_i420(r->buffer) : r->output->write(r->buffer))) {
+                    std::cerr << "\nCould not write frame " << packet.index << " to rendition '" << r->profile.name << "'" << std::endl;
+                    global::stop_video = true;
+                }
+            }
+        });
+    }
+
+    // Every feed is encoded on its own thread
+    for (auto& feed : feeds) {
+        feed->encode_thread = std::thread([&, f = feed.get()]() {
+            FramePacket packet;
+            while (true) {
+                f->rendered_frames->pop(packet);
+                if (packet.end_of_stream)
+                    break;
+                if (packet.drop)
+                    continue;
+                if (!(planar ? f->output->write_i420(packet.frame) : f->output->write(packet.frame))) {
+                    std::cerr << "\nCould not write frame " << packet.index << " to feed '" << f->profile.name << "'" << std::endl;
+                    global::stop_video = true;
+                }
+                f->frame_pool->release(std::move(packet.frame));
+            }
+        });
+    }
+
+    // Write processed frames to the output video file (encode stage runs on this thread)
+    // Allocations made while the pools, the background model and the renderer buffers settle are not counted as steady state
+    std::size_t warmup_frames = buffers_in_flight;
+    std::size_t allocations_prev = allocation_counter::count(), allocations_warm = 0, frames_warm = 0;
+    FramePacket packet;
+    while (true) {
+        // Sample before popping so that a stalled encoder shows up as a full render->encode queue
+        occupancy[0].sample(decoded_frames.size());
+        occupancy[1].sample(segmented_frames.size());
+        occupancy[2].sample(rendered_frames.size());
+
+        rendered_frames.pop(packet);
+        if (packet.end_of_stream)
+            break;
+
         std::cout << "\r"
-                  << "Processing frame: " << frame_counter++ << "/" << total_frames << std::flush;
-
-        // Perform background subtraction
-        back_sub->apply(frame(global::config.rendering_ROI), foreground_mask);
-        // Post-process foreground mask
-        foreground_mask.setTo(0, foreground_mask == 127);
-        cv::medianBlur(foreground_mask, foreground_mask, 3);
-        cv::erode(foreground_mask, foreground_mask, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
-        cv::dilate(foreground_mask, foreground_mask, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5)), cv::Point(-1, -1), 2);
-        cv::erode(foreground_mask, foreground_mask, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
-        // Render logos
-        opengl_renderer->render(frame, foreground_mask, global::filtered_shot_data);
-
-        // Write processed frame to the output video file
-        output_video.write(frame);
+                  << "Processing frame: " << packet.index + 1 << "/" << total_frames
+                  << " | queues " << occupancy[0].name << ": " << decoded_frames.size() << "/" << occupancy[0].capacity
+                  << ", " << occupancy[1].name << ": " << segmented_frames.size() << "/" << occupancy[1].capacity
+                  << ", " << occupancy[2].name << ": " << rendered_frames.size() << "/" << occupancy[2].capacity;
+
+        if (live) {
+            if (LiveClock::now() > packet.deadline)
+                packet.late = true;
+            if (packet.late)
+                live_counters.late++;
+            std::cout << " | late: " << live_counters.late.load() << ", dropped: " << live_counters.dropped.load();
+        }
+
+        if (packet.drop) {
+            live_counters.dropped++;
+        }
+        else {
+            // Rungs scale the frame while it is being encoded here
+            for (auto& rendition : renditions) {
+                FramePacket rendition_packet;
+                rendition_packet.index = packet.index;
+                rendition_packet.frame = packet.frame;
+                rendition->frames->push(std::move(rendition_packet));
+            }
+            if (!(planar ? output_video->write_i420(packet.frame) : output_video->write(packet.frame))) {
+                // e.g. the downstream end of the pipe went away: stop decoding and drain what is in flight
+                std::cerr << "\nCould not write frame " << packet.index << " to the output" << std::endl;
+                global::stop_video = true;
+            }
+            std::size_t scaled_index;
+            for (auto& rendition : renditions) {
+                rendition->scaled->pop(scaled_index);
+            }
+        }
+        frame_pool.release(std::move(packet.frame));
+        mask_pool.release(std::move(packet.foreground_mask));
+
+        if (allocation_counter::enabled()) {
+            std::size_t allocations = allocation_counter::count();
+            std::cout << " | allocations: " << allocations - allocations_prev;
+            if (packet.index >= warmup_frames) {
+                allocations_warm += allocations - allocations_prev;
+                frames_warm++;
+            }
+            allocations_prev = allocations;
+        }
+        std::cout << std::flush;
 
         // Outputing image instead or video for fast and easy debugging purposes
-        /* if(i==0){
-            imwrite("frame.png", frame);
-            i++;
+        /* if(packet.index==0){
+            imwrite("frame.png", packet.frame);
         } */
     }
+    std::cout << std::endl;
 
-    // Clear opengl resources
-    opengl_renderer->opengl_destroy();
+    decode_thread.join();
+    segmentation_thread.join();
+    render_thread.join();
+    for (auto& rendition : renditions) {
+        rendition->frames->push(FramePacket::end_of_stream_marker());
+        rendition->encode_thread.join();
+        rendition->output->release();
+    }
+    for (auto& feed : feeds) {
+        feed->encode_thread.join();
+        feed->output->release();
+    }
 
-    // release GL contexts
-    release_gl_context(glcontext);
+    // Report average/peak queue occupancy; the stage right after the fullest queue is the bottleneck
+    for (const auto& q : occupancy) {
+        std::cout << "Queue " << q.name << ": mean occupancy " << q.mean() << "/" << q.capacity << ", peak " << q.peak << "/" << q.capacity << std::endl;
+    }
+    if (render_frames > 0) {
+        std::cout << "Render stage (transfer depth " << transfer_depth << "): " << render_frames / render_seconds << " frames/s, "
+                  << transfer_latency_ms / render_frames << " ms mean latency from submission to completion" << std::endl;
+    }
+    if (live) {
+        std::cout << "Live: " << live_counters.late.load() << " late frames, " << live_counters.dropped.load() << " dropped, "
+                  << live_counters.passed_through.load() << " passed through without overlay, " << live_counters.reused_masks.load() << " with reused mask" << std::endl;
+    }
+    if (allocation_counter::enabled() && frames_warm > 0) {
+        std::cout << "Heap allocations per frame after warm-up: " << static_cast<double>(allocations_warm) / frames_warm << std::endl;
+    }
 
     // Release video resources (write trailer to output video file, etc)
+    input_video->release();
+    output_video->release();
+
+    return 0;
+}
+
+// Positions input so that the next read() returns frame target. Seeking by frame number is not frame-accurate for
+// every codec and container (the demuxer may land on a nearby keyframe), so the landing point is checked against the
+// timestamp of the first decoded frame (constant frame rate assumed). If the seek overshot, it is retried from further
+// back and the rest is decoded forward.
+bool seek_to_frame(cv::VideoCapture& input, std::size_t target, double fps)
+{
+    if (target == 0)
+        return true;
+    if (fps <= 0.)
+        return input.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(target));
+
+    cv::Mat frame;
+    long last = static_cast<long>(target) - 1; // frame to read last
+    long margin = 0;
+    while (true) {
+        long start = std::max(0L, last - margin);
+        input.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(start));
+        if (!input.read(frame))
+            return false;
+        long index = std::lround(input.get(cv::CAP_PROP_POS_MSEC) * fps / 1000.);
+        if (index <= last) {
+            for (; index < last; index++) {
+                if (!input.read(frame))
+                    return false;
+            }
+            return true;
+        }
+        if (start == 0) {
+            std::cerr << "Could not seek to frame " << target << ": decoding starts at frame " << index << std::endl;
+            return false;
+        }
+        // About a GOP first, then twice as far each time
+        margin = std::max(2 * margin, std::lround(2. * fps));
+    }
+}
+
+// Renders frames [begin, end) of the input video into segment_url. Frames [warmup_begin, begin) are decoded only to
+// train the background model, so that masks at the start of the chunk match a continuous run.
+bool process_chunk(std::size_t begin, std::size_t end, std::size_t warmup_begin, const std::string& segment_url, std::atomic<std::size_t>& frames_done)
+{
+    cv::VideoCapture input_video(global::config.input_video_url);
+    if (!input_video.isOpened()) {
+        std::cerr << "Could not open input video file" << std::endl;
+        return false;
+    }
+    if (!seek_to_frame(input_video, warmup_begin, input_video.get(cv::CAP_PROP_FPS))) {
+        std::cerr << "Could not seek to the start of the chunk at frame " << begin << std::endl;
+        return false;
+    }
+
+    int frame_width = input_video.get(cv::CAP_PROP_FRAME_WIDTH);
+    int frame_height = input_video.get(cv::CAP_PROP_FRAME_HEIGHT);
+    double fps = input_video.get(cv::CAP_PROP_FPS);
+
+    cv::VideoWriter output_video(segment_url, cv::VideoWriter::fourcc('a', 'v', 'c', '1'), fps, cv::Size(frame_width, frame_height));
+    if (!output_video.isOpened()) {
+        std::cerr << "Could not create output segment " << segment_url << std::endl;
+        return false;
+    }
+
+    // Each worker has its own segmenter, renderer and overlay state
+    ThreadPool segmentation_pool(1);
+    std::unique_ptr<ForegroundSegmenter> segmenter = create_foreground_segmenter(global::config, segmentation_pool, false);
+    MaskPostProcessor mask_postprocessor(nullptr, mask_filter_sizes());
+    SharedShotData shots;
+
+    std::unique_ptr<OpenGLRenderer> opengl_renderer = std::make_unique<OpenGLRenderer>(global::config);
+    get_gl_context_select_with_sleep_and_creation_check(glcontext, 20, true, opengl_renderer->get_gpu_id());
+    opengl_renderer->opengl_init(global::config);
+    // The warm-up frames train the model everywhere, not only where the first overlays of the chunk are
+    opengl_renderer->segment_whole_roi();
+
+    // Chunks read the snapshot but never write it, several of them run at once
+    BackgroundSnapshot background_snapshot;
+    if (load_background_snapshot(background_snapshot_path(global::config, false), global::config.rendering_ROI.size(), false, background_snapshot)) {
+        if (global::config.gpu_segmentation) {
+            cv::Mat warm_frame = cv::Mat::zeros(frame_height, frame_width, CV_8UC3);
+            cv::RNG rng;
+            for (std::size_t i = 0; i < global::config.snapshot_warm_frames; i++) {
+                synthesize_background(background_snapshot, global::config.rendering_ROI, cv::Rect(cv::Point(), global::config.rendering_ROI.size()), false, rng, warm_frame);
+                opengl_renderer->segment(warm_frame);
+            }
+        }
+        else {
+            segmenter->warm_start(background_snapshot, cv::Size(frame_width, frame_height), global::config.snapshot_warm_frames);
+        }
+    }
+
+    std::size_t next_timeline_entry = 0;
+    cv::Mat frame, foreground_mask, packed_mask;
+    for (std::size_t frame_index = warmup_begin; frame_index < end && !global::stop_video; frame_index++) {
+        if (!input_video.read(frame))
+            break;
+
+        if (global::config.gpu_segmentation) {
+            opengl_renderer->segment(frame);
+            if (frame_index < begin)
+                continue;
+        }
+        else {
+            segmenter->apply(frame, foreground_mask);
+            if (frame_index < begin)
+                continue;
+            mask_postprocessor.apply(foreground_mask);
+            pack_mask(foreground_mask, packed_mask);
+        }
+
+        // On the first frame of the chunk this replays every earlier entry, which leaves the overlay in the same state
+        // as a continuous run
+        while (next_timeline_entry < global::timeline.size() && global::timeline[next_timeline_entry].frame <= static_cast<long>(frame_index)) {
+            apply_timeline_entry(global::timeline[next_timeline_entry++], shots);
+        }
+
+        // The next read reuses the frame buffer, so the transfers are completed right away
+        opengl_renderer->render(frame, packed_mask, shots);
+        opengl_renderer->finish_render();
+        output_video.write(frame);
+        frames_done++;
+    }
+
+    opengl_renderer->opengl_destroy();
+    release_gl_context(glcontext);
+
     input_video.release();
     output_video.release();
 
-    return 0;
+    return true;
+}
+
+// Joins the encoded segments into output_url. Stream-copies them with ffmpeg if their codec parameters match (see
+// concat_h264) and falls back to decoding and re-encoding the segments with OpenCV otherwise.
+bool join_segments(const std::vector<std::string>& segments, const std::string& output_url)
+{
+    // Pieces copied from the input and pieces encoded by OpenCV can differ in profile or pixel format
+    if (same_codec_parameters(segments) && concat_h264(segments, output_url))
+        return true;
+
+    std::cerr << "Could not join segments with ffmpeg or their codec parameters differ. Re-encoding them instead." << std::endl;
+    cv::VideoWriter output_video;
+    cv::Mat frame;
+    for (const auto& segment : segments) {
+        cv::VideoCapture input_video(segment);
+        if (!input_video.isOpened()) {
+            std::cerr << "Could not open segment " << segment << std::endl;
+            return false;
+        }
+        if (!output_video.isOpened()) {
+            output_video.open(output_url, cv::VideoWriter::fourcc('a', 'v', 'c', '1'), input_video.get(cv::CAP_PROP_FPS), cv::Size(input_video.get(cv::CAP_PROP_FRAME_WIDTH), input_video.get(cv::CAP_PROP_FRAME_HEIGHT)));
+            if (!output_video.isOpened()) {
+                std::cerr << "Could not create output video file" << std::endl;
+                return false;
+            }
+        }
+        while (input_video.read(frame)) {
+            output_video.write(frame);
+        }
+    }
+    output_video.release();
+    return true;
+}
+
+// Offline render of a whole file: the input is cut into time chunks that are processed by independent workers
+// (decode, background subtraction, rendering and encoding each) and the segments are joined at the end.
+// Overlays come from the headless timeline. With offline.smart_render only the GOPs that show an overlay are rendered;
+// the rest of the input is packet-copied into the output.
+int offline_streamer()
+{
+    cv::VideoCapture probe(global::config.input_video_url);
+    if (!probe.isOpened()) {
+        std::cerr << "Could not open input video file" << std::endl;
+        return -1;
+    }
+    double fps = probe.get(cv::CAP_PROP_FPS);
+    std::size_t total_frames = probe.get(cv::CAP_PROP_FRAME_COUNT);
+    probe.release();
+    if (total_frames == 0) {
+        // Chunks are cut by frame count
+        std::cerr << "The input does not report its frame count. Rendering it in one pass instead of in chunks." << std::endl;
+        return streamer();
+    }
+    // Chunks only write the main output
+    if (!global::config.feeds.empty())
+        std::cerr << "Feeds are not rendered by --offline, only the main output is written." << std::endl;
+    if (!global::config.renditions.empty())
+        std::cerr << "Renditions are not encoded by --offline, only the main output is written." << std::endl;
+
+    resolve_timeline(global::timeline, fps);
+
+    std::size_t num_workers = global::config.offline_chunks;
+    if (num_workers == 0)
+        num_workers = std::max(1u, std::thread::hardware_concurrency());
+    num_workers = std::max<std::size_t>(1, std::min(num_workers, total_frames));
+
+    // Output pieces in order; the ones in jobs are rendered, the others already exist
+    std::vector<std::string> segments;
+    std::vector<std::pair<FrameRange, std::string>> jobs;
+    std::vector<std::string> copied;
+
+    if (global::config.offline_smart_render) {
+        // Rendered pieces are encoded as H.264 by OpenCV, so they can only be concatenated with H.264 input packets
+        std::string codec = probe_video_codec(global::config.input_video_url);
+        std::size_t packets = 0;
+        std::vector<CutPoint> cuts = probe_cut_points(global::config.input_video_url, packets);
+        std::vector<std::size_t> keyframes;
+        for (const auto& cut : cuts)
+            keyframes.push_back(cut.frame);
+        std::vector<SmartRenderPiece> pieces = plan_smart_render(keyframes, overlay_ranges(global::timeline, total_frames), total_frames);
+        std::string prefix = global::config.output_video_url + ".piece";
+        if (codec != "h264" || pieces.empty()) {
+            std::cerr << "Smart render needs ffprobe and H.264 input (got '" << codec << "'). Rendering every frame instead." << std::endl;
+        }
+        else if (packets != total_frames) {
+            // Rendered pieces are cut by decoded frame, copied ones by packet
+            std::cerr << "Smart render: the input has " << packets << " packets for " << total_frames << " frames. Rendering every frame instead." << std::endl;
+        }
+        else if (split_into_pieces(global::config.input_video_url, pieces, cuts, prefix)) {
+            std::size_t rendered_frames = 0;
+            for (std::size_t k = 0; k < pieces.size(); k++) {
+                copied.push_back(piece_url(prefix, k));
+                if (pieces[k].render) {
+                    segments.push_back(global::config.output_video_url + ".render" + std::to_string(k) + ".mp4");
+                    jobs.push_back({pieces[k].frames, segments.back()});
+                    rendered_frames += pieces[k].frames.end - pieces[k].frames.begin;
+                }
+                else {
+                    segments.push_back(copied.back());
+                }
+            }
+            std::cout << "Smart render: re-encoding " << rendered_frames << "/" << total_frames << " frames in " << jobs.size() << " pieces, copying the rest" << std::endl;
+        }
+        else {
+            std::cerr << "Rendering every frame instead." << std::endl;
+            for (std::size_t k = 0; k <= pieces.size(); k++) {
+                fs::remove(piece_url(prefix, k));
+            }
+        }
+    }
+    if (segments.empty()) {
+        for (std::size_t k = 0; k < num_workers; k++) {
+            segments.push_back(global::config.output_video_url + ".chunk" + std::to_string(k) + ".mp4");
+            jobs.push_back({{k * total_frames / num_workers, (k + 1) * total_frames / num_workers}, segments.back()});
+        }
+    }
+    num_workers = std::max<std::size_t>(1, std::min(num_workers, jobs.size()));
+
+    std::size_t frames_to_render = 0;
+    for (const auto& job : jobs) {
+        frames_to_render += job.first.end - job.first.begin;
+    }
+
+    // One GL context per worker
+    GlobalGLContexts::instance().set_max_contexts(num_workers, 1);
+
+    // Workers pull jobs until none are left
+    std::vector<std::thread> workers;
+    std::vector<char> succeeded(jobs.size(), 0);
+    std::atomic<std::size_t> frames_done{0}, workers_finished{0}, next_job{0};
+    for (std::size_t w = 0; w < num_workers; w++) {
+        workers.emplace_back([&]() {
+            for (std::size_t j = next_job++; j < jobs.size() && !global::stop_video; j = next_job++) {
+                std::size_t begin = jobs[j].first.begin, end = jobs[j].first.end;
+                std::size_t warmup_begin = (begin > global::config.offline_warmup_frames) ? begin - global::config.offline_warmup_frames : 0;
+                succeeded[j] = process_chunk(begin, end, warmup_begin, jobs[j].second, frames_done);
+            }
+            workers_finished++;
+        });
+    }
+
+    while (workers_finished.load() < num_workers) {
+        std::cout << "\r"
+                  << "Processing frame: " << frames_done.load() << "/" << frames_to_render << " (" << jobs.size() << " chunks)" << std::flush;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::cout << "\r"
+              << "Processing frame: " << frames_done.load() << "/" << frames_to_render << " (" << jobs.size() << " chunks)" << std::endl;
+
+    int ret = 0;
+    if (std::find(succeeded.begin(), succeeded.end(), 0) != succeeded.end() || !join_segments(segments, global::config.output_video_url)) {
+        std::cerr << "Offline render failed" << std::endl;
+        ret = -1;
+    }
+    for (const auto& job : jobs) {
+        fs::remove(job.second);
+    }
+    for (const auto& piece : copied) {
+        fs::remove(piece);
+    }
+
+    return ret;
 }
 
 int createGui()
@@ -391,31 +1311,12 @@ int createGui()
 
             if (apply) // Getting filtered_shot_data using filters
             {
-                global::filtered_shot_data.mutex.lock();
-                global::hackyData.timePeriod = filter.quarter;
-                global::hackyData.displayTab = filter.displayTab;
-                global::hackyData.displayShots = filter.displayShots;
-                global::hackyData.displayCourtStats = filter.displayCourtStats;
-                global::hackyData.displayLogoMiddle = filter.displayLogoMiddle;
-                global::hackyData.displayRegions = filter.displayRegions;
-                global::hackyData.team = filter.team;
-                global::hackyData.player = filter.player;
-                global::hackyData.shotType = filter.shotType;
-                std::vector<ShotDataEntry> filtered_data = filter_shot_data(global::shot_data, filter);
-                Stats stats = get_stats(global::shot_data, filter);
-                global::filtered_shot_data.shot_data = filtered_data;
-                global::filtered_shot_data.stats = stats;
-                global::filtered_shot_data.updated.store(true);
-                global::filtered_shot_data.mutex.unlock();
+                apply_filter(filter, global::hackyData.side, global::filtered_shot_data);
                 apply = false;
             }
             else if (clear) {
-                global::filtered_shot_data.mutex.lock();
                 global::hackyData.reset();
-                global::filtered_shot_data.shot_data.clear();
-                global::filtered_shot_data.stats.reset();
-                global::filtered_shot_data.updated.store(true);
-                global::filtered_shot_data.mutex.unlock();
+                clear_filter(global::filtered_shot_data);
                 clear = false;
             }
 
@@ -461,20 +1362,62 @@ int main(int argc, char** argv)
     sigIntHandler.sa_flags = 0;
     sigaction(SIGINT, &sigIntHandler, NULL);
     sigaction(SIGKILL, &sigIntHandler, NULL);
+    // A closed output pipe is reported by the failing write instead of killing the process
+    signal(SIGPIPE, SIG_IGN);
 
-    // Read configuration file
+    // Read command line: streamer [path/to/config.yml] [--headless path/to/timeline.yml] [--offline]
     std::string config_file = "config.yml";
-    if (argc >= 2) {
-        config_file = std::string(argv[1]);
+    std::string timeline_file = "";
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--offline") {
+            global::offline = true;
+        }
+        else if (arg == "--headless") {
+            if (i + 1 >= argc) {
+                std::cerr << "--headless expects a timeline file" << std::endl;
+                return -1;
+            }
+            global::headless = true;
+            timeline_file = std::string(argv[++i]);
+        }
+        else {
+            config_file = arg;
+        }
     }
     global::config = read_config_file(config_file);
+    if (global::config.pixel_format == "i420") {
+        // Offline chunks decode with cv::VideoCapture and stay BGR
+        if (global::offline) {
+            global::config.pixel_format = "bgr";
+        }
+        else {
+            global::config.rendering_ROI = align_to_chroma(global::config.rendering_ROI);
+        }
+    }
+    else if (global::config.pixel_format != "bgr") {
+        std::cerr << "Unknown pixel format '" << global::config.pixel_format << "'. Using 'bgr'." << std::endl;
+        global::config.pixel_format = "bgr";
+    }
     global::shot_data = load_shot_data(global::config.data_url);
+    if (global::headless) {
+        global::timeline = read_timeline_file(timeline_file);
+    }
 
-    streamerThread = std::thread(streamer);
+    // Offline chunked rendering has no single frame position an operator could follow, so it is scripted only
+    if (global::offline && !global::headless) {
+        std::cerr << "--offline needs a timeline: run with --headless <timeline.yml>" << std::endl;
+        return -1;
+    }
+
+    streamerThread = std::thread(global::offline ? offline_streamer : streamer);
     // std::this_thread::sleep_for(std::chrono::seconds(2));
-    GUIThread = std::thread(createGui);
-    GUIThread.join();
+    // In headless mode there is no display server: skip GLFW/ImGui entirely
+    if (!global::headless) {
+        GUIThread = std::thread(createGui);
+        GUIThread.join();
+    }
     streamerThread.join();
 
     return 0;
-}
\ No newline at end of file
+}
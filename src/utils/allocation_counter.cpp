@@ -0,0 +1,45 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<std::size_t> heap_allocations{0};
+} // namespace
+
+#ifdef STREAMER_COUNT_ALLOCATIONS
+// Replacing the plain forms is enough: the array and nothrow forms of libstdc++ forward to these
+void* operator new(std::size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace allocation_counter {
+    bool enabled()
+    {
+#ifdef STREAMER_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    std::size_t count() { return heap_allocations.load(std::memory_order_relaxed); }
+} // namespace allocation_counter
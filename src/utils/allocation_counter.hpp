@@ -0,0 +1,13 @@
+#ifndef UTILS_ALLOCATION_COUNTER_HPP
+#define UTILS_ALLOCATION_COUNTER_HPP
+
+#include <cstddef>
+
+// Debug counter of process-wide heap allocations (every global operator new, which also covers every cv::Mat buffer
+// since OpenCV allocates its UMatData with new). Only active when built with `./waf configure --count-allocations`.
+namespace allocation_counter {
+    bool enabled();
+    std::size_t count();
+} // namespace allocation_counter
+
+#endif
@@ -0,0 +1,83 @@
+#include "subprocess.hpp"
+
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // Forks and runs the tool; its standard output goes to stdout_fd if that is not -1
+    pid_t spawn(const std::vector<std::string>& args, int stdout_fd)
+    {
+        std::vector<char*> argv;
+        for (const auto& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (stdout_fd != -1)
+                dup2(stdout_fd, STDOUT_FILENO);
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        return pid;
+    }
+
+    bool wait_for(pid_t pid)
+    {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0) {
+            if (errno != EINTR)
+                return false;
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+} // namespace
+
+bool run_tool(const std::vector<std::string>& args)
+{
+    if (args.empty())
+        return false;
+    pid_t pid = spawn(args, -1);
+    return pid > 0 && wait_for(pid);
+}
+
+bool run_tool(const std::vector<std::string>& args, std::vector<std::string>& lines)
+{
+    lines.clear();
+    if (args.empty())
+        return false;
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+    pid_t pid = spawn(args, fds[1]);
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return false;
+    }
+
+    std::string line;
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (ssize_t i = 0; i < size; i++) {
+            if (buffer[i] == '\n') {
+                lines.push_back(line);
+                line.clear();
+            }
+            else if (buffer[i] != '\r') {
+                line.push_back(buffer[i]);
+            }
+        }
+    }
+    close(fds[0]);
+    if (!line.empty())
+        lines.push_back(line);
+    return wait_for(pid);
+}
@@ -0,0 +1,14 @@
+#ifndef UTILS_SUBPROCESS_HPP
+#define UTILS_SUBPROCESS_HPP
+
+#include <string>
+#include <vector>
+
+// Runs a command line tool (args[0], looked up in PATH) with the given arguments and waits for it. There is no shell
+// in between, so arguments such as paths are passed as they are and need no quoting. Returns whether the tool exited
+// with status 0.
+bool run_tool(const std::vector<std::string>& args);
+// Same, collecting the standard output of the tool line by line
+bool run_tool(const std::vector<std::string>& args, std::vector<std::string>& lines);
+
+#endif
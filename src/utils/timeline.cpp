@@ -0,0 +1,102 @@
+#include "timeline.hpp"
+
+// std headers
+#include <filesystem>
+namespace fs = std::filesystem;
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+Timeline read_timeline_file(const std::string& filename)
+{
+    Timeline timeline;
+
+    // First load file contents to buffer
+    std::ifstream t(fs::absolute(filename));
+    if (!t.is_open()) { // Error in reading, return empty timeline
+        std::cerr << "Error reading timeline file: " << filename << std::endl;
+        return timeline;
+    }
+    t.seekg(0, std::ios::end);
+    std::size_t size = t.tellg();
+    std::string buffer(size, ' ');
+    t.seekg(0);
+    t.read(&buffer[0], size);
+
+    // Read yaml file to Tree structure
+    ryml::Tree tree = ryml::parse_in_arena(c4::to_csubstr(buffer));
+    ryml::NodeRef r = tree.rootref();
+
+    try {
+        for (auto c : r.children()) {
+            if (c.key() == "timeline") {
+                for (auto c1 : c.children()) {
+                    TimelineEntry entry;
+                    for (auto c2 : c1.children()) {
+                        if (c2.key() == "frame") {
+                            entry.frame = get_value<long>(c2);
+                        }
+                        else if (c2.key() == "time") {
+                            entry.time = get_value<double>(c2);
+                        }
+                        else if (c2.key() == "action") {
+                            entry.clear = (get_value<std::string>(c2) == "clear");
+                        }
+                        else if (c2.key() == "side") {
+                            entry.side = get_value<int>(c2);
+                        }
+                        else if (c2.key() == "filter") {
+                            read_filter(c2, entry.filter);
+                        }
+                    }
+                    if (entry.frame < 0 && entry.time < 0.) {
+                        std::cerr << "Timeline entry without frame or time. Ignoring it." << std::endl;
+                        continue;
+                    }
+                    timeline.push_back(entry);
+                }
+            }
+        }
+    }
+    catch (...) {
+        std::cerr << "Error reading timeline file: " << filename << std::endl;
+        timeline.clear();
+    }
+
+    return timeline;
+}
+
+void resolve_timeline(Timeline& timeline, double fps)
+{
+    for (auto& entry : timeline) {
+        if (entry.frame < 0) {
+            entry.frame = std::lround(entry.time * fps);
+        }
+    }
+    // Entries on the same frame keep their file order
+    std::stable_sort(timeline.begin(), timeline.end(), [](const TimelineEntry& a, const TimelineEntry& b) { return a.frame < b.frame; });
+}
+
+std::vector<FrameRange> overlay_ranges(const Timeline& timeline, std::size_t total_frames)
+{
+    std::vector<FrameRange> ranges;
+    bool visible = false;
+    std::size_t begin = 0;
+    for (const auto& entry : timeline) {
+        const Filter& f = entry.filter;
+        bool entry_visible = !entry.clear && (f.displayShots || f.displayCourtStats || f.displayRegions || f.displayTab || f.displayLogoMiddle);
+        std::size_t frame = std::min<std::size_t>(std::max<long>(entry.frame, 0), total_frames);
+        if (entry_visible && !visible) {
+            begin = frame;
+        }
+        else if (!entry_visible && visible && frame > begin) {
+            ranges.push_back({begin, frame});
+        }
+        visible = entry_visible;
+    }
+    if (visible && total_frames > begin)
+        ranges.push_back({begin, total_frames});
+    return ranges;
+}
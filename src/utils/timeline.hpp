@@ -0,0 +1,32 @@
+#ifndef UTILS_TIMELINE_HPP
+#define UTILS_TIMELINE_HPP
+
+#include <utils/utils.hpp>
+
+#include <string>
+#include <vector>
+
+// One scripted step of a headless run: what the operator would have selected in the GUI, and when
+struct TimelineEntry {
+    long frame = -1; // frame index the entry is applied at (before that frame is rendered)
+    double time = -1.; // alternative to frame: timestamp in seconds, converted with the input frame rate
+    bool clear = false; // "clear" action instead of "apply"
+    Filter filter;
+    int side = 0; // court side to print on (0: left, 1: right)
+};
+
+using Timeline = std::vector<TimelineEntry>;
+
+// Half-open range of frame indices [begin, end)
+struct FrameRange {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+Timeline read_timeline_file(const std::string& filename);
+// Converts timestamps to frame indices and sorts the entries by frame
+void resolve_timeline(Timeline& timeline, double fps);
+// Frame ranges in which the (resolved) timeline puts something on screen, merged and clipped to total_frames
+std::vector<FrameRange> overlay_ranges(const Timeline& timeline, std::size_t total_frames);
+
+#endif
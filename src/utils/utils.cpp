@@ -34,6 +34,42 @@ std::string get_value<std::string>(const c4::yml::NodeRef& c)
     return _get_str_val(c);
 }
 
+void read_filter(const c4::yml::NodeRef& c, Filter& filter)
+{
+    for (auto c1 : c.children()) {
+        if (c1.key() == "quarter") {
+            filter.quarter = get_value<int>(c1);
+        }
+        else if (c1.key() == "team") {
+            filter.team = get_value<int>(c1);
+        }
+        else if (c1.key() == "player") {
+            filter.player = get_value<int>(c1);
+        }
+        else if (c1.key() == "shot_type") {
+            filter.shotType = get_value<int>(c1);
+        }
+        else if (c1.key() == "made") {
+            filter.made = get_value<int>(c1);
+        }
+        else if (c1.key() == "display_shots") {
+            filter.displayShots = get_value<bool>(c1);
+        }
+        else if (c1.key() == "display_court_stats") {
+            filter.displayCourtStats = get_value<bool>(c1);
+        }
+        else if (c1.key() == "display_regions") {
+            filter.displayRegions = get_value<bool>(c1);
+        }
+        else if (c1.key() == "display_tab") {
+            filter.displayTab = get_value<bool>(c1);
+        }
+        else if (c1.key() == "display_logo_middle") {
+            filter.displayLogoMiddle = get_value<bool>(c1);
+        }
+    }
+}
+
 inline void read_logo_data(const c4::yml::NodeRef& c, LogoData& logo)
 {
     double x = 0., y = 0., z = 0.;
@@ -324,6 +360,228 @@ StreamerConfiguration read_config_file(const std::string& filename)
                     else if (c1.key() == "detect_shadows") {
                         config.detect_shadows = get_value<bool>(c1);
                     }
+                    else if (c1.key() == "segmenter") {
+                        config.segmenter = get_value<std::string>(c1);
+                    }
+                    else if (c1.key() == "knn_distance_threshold") {
+                        config.knn_distance_threshold = get_value<double>(c1);
+                    }
+                    else if (c1.key() == "torch") {
+                        for (auto c2 : c1.children()) {
+                            if (c2.key() == "model") {
+                                config.torch_model_path = get_value<std::string>(c2);
+                            }
+                            else if (c2.key() == "batch_size") {
+                                config.torch_batch_size = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "threads") {
+                                config.torch_threads = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "int8") {
+                                config.torch_int8 = get_value<bool>(c2);
+                            }
+                            else if (c2.key() == "input_scale") {
+                                config.torch_input_scale = get_value<double>(c2);
+                            }
+                            else if (c2.key() == "person_class") {
+                                config.torch_person_class = get_value<int>(c2);
+                            }
+                        }
+                    }
+                    else if (c1.key() == "clean_plate") {
+                        for (auto c2 : c1.children()) {
+                            if (c2.key() == "frames") {
+                                config.clean_plate_frames = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "samples") {
+                                config.clean_plate_samples = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "noise_factor") {
+                                config.clean_plate_noise_factor = get_value<double>(c2);
+                            }
+                            else if (c2.key() == "min_threshold") {
+                                config.clean_plate_min_threshold = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "drift_interval") {
+                                config.clean_plate_drift_interval = get_value<int>(c2);
+                            }
+                        }
+                    }
+                    else if (c1.key() == "snapshot") {
+                        for (auto c2 : c1.children()) {
+                            if (c2.key() == "directory") {
+                                config.snapshot_directory = get_value<std::string>(c2);
+                            }
+                            else if (c2.key() == "venue") {
+                                config.snapshot_venue = get_value<std::string>(c2);
+                            }
+                            else if (c2.key() == "interval") {
+                                config.snapshot_interval = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "warm_frames") {
+                                config.snapshot_warm_frames = get_value<int>(c2);
+                            }
+                        }
+                    }
+                    else if (c1.key() == "tiles") {
+                        std::size_t idx = 0;
+                        for (auto c2 : c1.children()) {
+                            if (idx == 0) {
+                                config.segmentation_tiles_x = get_value<int>(c2);
+                            }
+                            else if (idx == 1) {
+                                config.segmentation_tiles_y = get_value<int>(c2);
+                            }
+                            idx++;
+                        }
+                    }
+                    else if (c1.key() == "threads") {
+                        config.segmentation_threads = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "model_scale") {
+                        config.model_scale = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "decimation") {
+                        for (auto c2 : c1.children()) {
+                            if (c2.key() == "max_interval") {
+                                config.decimation_max_interval = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "mode") {
+                                config.decimation_mode = get_value<std::string>(c2);
+                            }
+                            else if (c2.key() == "activity_threshold") {
+                                config.decimation_activity_threshold = get_value<double>(c2);
+                            }
+                        }
+                    }
+                    else if (c1.key() == "gpu") {
+                        config.gpu_segmentation = get_value<bool>(c1);
+                    }
+                    else if (c1.key() == "postprocessing") {
+                        for (auto c2 : c1.children()) {
+                            if (c2.key() == "median") {
+                                config.mask_median_size = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "erode") {
+                                config.mask_erode_size = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "dilate") {
+                                config.mask_dilate_size = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "dilate_iterations") {
+                                config.mask_dilate_iterations = get_value<int>(c2);
+                            }
+                            else if (c2.key() == "close_erode") {
+                                config.mask_close_erode_size = get_value<int>(c2);
+                            }
+                        }
+                    }
+                }
+            }
+            else if (c.key() == "io") {
+                for (auto c1 : c.children()) {
+                    if (c1.key() == "input_format") {
+                        config.input_format = get_value<std::string>(c1);
+                    }
+                    else if (c1.key() == "output_format") {
+                        config.output_format = get_value<std::string>(c1);
+                    }
+                    else if (c1.key() == "frame_width") {
+                        config.raw_frame_width = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "frame_height") {
+                        config.raw_frame_height = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "fps") {
+                        config.raw_fps = get_value<double>(c1);
+                    }
+                }
+            }
+            else if (c.key() == "live") {
+                for (auto c1 : c.children()) {
+                    if (c1.key() == "enabled") {
+                        config.live = get_value<bool>(c1);
+                    }
+                    else if (c1.key() == "latency_budget_ms") {
+                        config.live_latency_budget_ms = get_value<double>(c1);
+                    }
+                    else if (c1.key() == "late_policy") {
+                        config.live_late_policy = get_value<std::string>(c1);
+                    }
+                }
+            }
+            else if (c.key() == "offline") {
+                for (auto c1 : c.children()) {
+                    if (c1.key() == "chunks") {
+                        config.offline_chunks = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "warmup_frames") {
+                        config.offline_warmup_frames = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "smart_render") {
+                        config.offline_smart_render = get_value<bool>(c1);
+                    }
+                }
+            }
+            else if (c.key() == "feeds") {
+                config.feeds.clear();
+                for (auto c1 : c.children()) {
+                    FeedProfile feed;
+                    for (auto c2 : c1.children()) {
+                        if (c2.key() == "name") {
+                            feed.name = get_value<std::string>(c2);
+                        }
+                        else if (c2.key() == "output_video_url") {
+                            feed.output_video_url = get_value<std::string>(c2);
+                        }
+                        else if (c2.key() == "side") {
+                            feed.side = get_value<int>(c2);
+                        }
+                        else if (c2.key() == "filter") {
+                            read_filter(c2, feed.filter);
+                        }
+                    }
+                    config.feeds.push_back(feed);
+                }
+            }
+            else if (c.key() == "renditions") {
+                config.renditions.clear();
+                for (auto c1 : c.children()) {
+                    RenditionProfile rendition;
+                    for (auto c2 : c1.children()) {
+                        if (c2.key() == "name") {
+                            rendition.name = get_value<std::string>(c2);
+                        }
+                        else if (c2.key() == "output_video_url") {
+                            rendition.output_video_url = get_value<std::string>(c2);
+                        }
+                        else if (c2.key() == "width") {
+                            rendition.width = get_value<int>(c2);
+                        }
+                        else if (c2.key() == "height") {
+                            rendition.height = get_value<int>(c2);
+                        }
+                    }
+                    config.renditions.push_back(rendition);
+                }
+            }
+            else if (c.key() == "pipeline") {
+                for (auto c1 : c.children()) {
+                    if (c1.key() == "queue_depth") {
+                        config.queue_depth = get_value<int>(c1);
+                    }
+                    else if (c1.key() == "pixel_format") {
+                        config.pixel_format = get_value<std::string>(c1);
+                    }
+                    else if (c1.key() == "segmentation_chroma") {
+                        config.segmentation_chroma = get_value<bool>(c1);
+                    }
+                    else if (c1.key() == "footprint_only") {
+                        config.footprint_only = get_value<bool>(c1);
+                    }
+                    else if (c1.key() == "transfer_depth") {
+                        config.transfer_depth = get_value<int>(c1);
+                    }
                 }
             }
             else if (c.key() == "opengl_rendering") {
@@ -74,13 +74,6 @@ struct Stats {
     }
 };
 
-struct SharedShotData {
-    ShotData shot_data;
-    std::mutex mutex;
-    std::atomic<bool> updated{false};
-    Stats stats;
-};
-
 struct Logos {
     cv::Mat teamA;
     cv::Mat teamB;
@@ -118,6 +111,14 @@ struct HackyData {
     }
 };
 
+struct SharedShotData {
+    ShotData shot_data;
+    std::mutex mutex;
+    std::atomic<bool> updated{false};
+    Stats stats;
+    HackyData display;
+};
+
 struct Point_3d {
     double x, y;
     Point_3d(double xPos, double yPos) 
@@ -151,10 +152,33 @@ struct Region {
     }
 };
 
+// Additional output of a multi-feed run: same frames and foreground masks, its own overlay selection
+struct FeedProfile {
+    std::string name;
+    std::string output_video_url;
+    int side = 0;
+    Filter filter;
+};
+
+// Downscaled copy of the main output (ABR ladder rung)
+struct RenditionProfile {
+    std::string name;
+    std::string output_video_url;
+    int width = 0;
+    int height = 0;
+};
+
 struct StreamerConfiguration {
     std::string input_video_url = "";
     std::string output_video_url = "";
     std::string data_url = "";
+    // Input/Output: "file" (OpenCV decode/encode), "bgr24" (raw packed BGR) or "y4m" (YUV4MPEG2). Raw urls may be "-" for stdin/stdout or a named FIFO
+    std::string input_format = "file";
+    std::string output_format = "file";
+    // Geometry of raw bgr24 input (y4m takes it from the stream header)
+    int raw_frame_width = 3840;
+    int raw_frame_height = 2160;
+    double raw_fps = 50.;
     // Shots
     std::string green_circle_url = "";
     std::string red_x_url = "";
@@ -169,6 +193,82 @@ struct StreamerConfiguration {
     std::size_t bg_sub_history = 1000;
     double distance_threshold = 50.;
     bool detect_shadows = true;
+    // Foreground segmenter: "mog2" or "knn" (OpenCV background models, everything below applies), "torch" (person
+    // segmentation network, see TorchSegmenter) or "clean_plate" (see CleanPlateSegmenter)
+    std::string segmenter = "mog2";
+    double knn_distance_threshold = 400.;
+    // Torch segmenter: TorchScript model, frames per forward pass, intra-op threads (0: libtorch default), whether the
+    // model is int8-quantized, network input size relative to the ROI and the class that counts as foreground
+    std::string torch_model_path = "person_segmentation.pt";
+    std::size_t torch_batch_size = 4;
+    std::size_t torch_threads = 0;
+    bool torch_int8 = false;
+    double torch_input_scale = 0.5;
+    int torch_person_class = 15;
+    // Clean-plate segmenter: median plate from samples of the first clean_plate_frames frames, per-pixel threshold of
+    // min_threshold + noise_factor * noise, plate drifting towards background pixels every drift_interval frames (0: never)
+    std::size_t clean_plate_frames = 300;
+    std::size_t clean_plate_samples = 31;
+    double clean_plate_noise_factor = 3.;
+    int clean_plate_min_threshold = 30;
+    std::size_t clean_plate_drift_interval = 0;
+    // Background snapshot (see BackgroundSnapshot): plate and noise of the ROI, kept in snapshot_directory (empty:
+    // disabled) per venue and calibration. Saved every snapshot_interval frames (0: only at exit) and replayed into
+    // the model for snapshot_warm_frames frames at startup.
+    std::string snapshot_directory = "";
+    std::string snapshot_venue = "default";
+    std::size_t snapshot_interval = 0;
+    std::size_t snapshot_warm_frames = 30;
+    // Tiled segmentation: grid of tiles with one model each, updated in parallel together with the mask
+    // post-processing on segmentation_threads threads (0: one per hardware thread)
+    int segmentation_tiles_x = 1;
+    int segmentation_tiles_y = 1;
+    std::size_t segmentation_threads = 1;
+    // 1, 2 or 4: background model runs on a 1/model_scale downscaled ROI
+    int model_scale = 1;
+    // Temporal decimation: update the model every N frames (N adapts up to max_interval; 1 disables it). In between,
+    // frames are classified against the frozen model ("frozen") or the previous mask is moved by the global motion ("shift")
+    std::size_t decimation_max_interval = 1;
+    std::string decimation_mode = "frozen";
+    double decimation_activity_threshold = 3.;
+    // Mask clean-up: median (speckles), erode, dilate x iterations (holes) and a final erode; odd sizes, 0 skips a step
+    int mask_median_size = 3;
+    int mask_erode_size = 3;
+    int mask_dilate_size = 5;
+    int mask_dilate_iterations = 2;
+    int mask_close_erode_size = 3;
+    // Gaussian-mixture model and mask clean-up run as compute shaders on the frame already uploaded for compositing;
+    // the mask never leaves the GPU (replaces the CPU model, tiles/model_scale/decimation do not apply)
+    bool gpu_segmentation = false;
+    // Pipeline
+    std::size_t queue_depth = 4;
+    // "bgr" or "i420": with i420 frames stay in planar YUV from decode to encode, segmentation runs on the Y plane
+    // (plus half-resolution chroma if segmentation_chroma) and overlays are composited into the planes
+    std::string pixel_format = "bgr";
+    bool segmentation_chroma = false;
+    // Overlay footprint: segmentation, mask clean-up, upload, compositing and readback only cover the parts of the ROI
+    // that overlays (court, logos, tabs, shots) actually project to. Models of areas that were not covered before start
+    // fresh when an overlay moves there.
+    bool footprint_only = false;
+    // Frames in flight between CPU and GPU in the render stage (1: synchronous upload and readback). Above 1, uploads
+    // and readbacks go through a ring of pixel buffers with fences, so the next frame is uploaded while the GPU is
+    // still compositing and reading back the previous ones.
+    std::size_t transfer_depth = 1;
+    // Live mode: frames are paced at the input frame rate and each one has to be written within the latency budget.
+    // Frames that would miss it are handled by the late policy: "drop", "passthrough" (no overlay) or "reuse_mask"
+    bool live = false;
+    double live_latency_budget_ms = 200.;
+    std::string live_late_policy = "passthrough";
+    // Offline chunked processing (--offline): number of chunks/workers (0: one per hardware thread) and
+    // frames before each chunk used only to train the background model
+    std::size_t offline_chunks = 0;
+    std::size_t offline_warmup_frames = 500;
+    // Smart render: GOPs without overlay are stream-copied from the input instead of being re-encoded
+    bool offline_smart_render = false;
+    // Multi-feed: extra outputs rendered from the same decode and segmentation pass
+    std::vector<FeedProfile> feeds;
+    // Renditions of the main output at lower resolutions, scaled after compositing and encoded in the same pass
+    std::vector<RenditionProfile> renditions;
     // OpenGL Rendering
     std::vector<LogoData> logos;
     std::vector<ShotChartData> shots;
@@ -216,6 +316,15 @@ T get_value(const c4::yml::NodeRef& c)
     return val;
 }
 
+// Defined in utils.cpp ("True"/"False" booleans, whole strings); declared here so every translation unit uses them
+template <>
+bool get_value<bool>(const c4::yml::NodeRef& c);
+template <>
+std::string get_value<std::string>(const c4::yml::NodeRef& c);
+
+// Reads a filter selection (quarter, team, player, shot_type, made, display_* flags) as used by timelines and feeds
+void read_filter(const c4::yml::NodeRef& c, Filter& filter);
+
 cv::Rect calculate_fit_ROI(const cv::Mat& src, const cv::Rect& dst_roi, std::string align_x, std::string align_y);
 
 cv::Mat read_image(const std::string& image_path, bool with_alpha);
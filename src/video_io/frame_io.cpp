@@ -0,0 +1,82 @@
+#include "frame_io.hpp"
+
+#include <video_io/raw_frame_io.hpp>
+
+#include <opencv2/imgproc.hpp>
+
+#include <iostream>
+
+bool FrameSource::read_i420(cv::Mat& frame)
+{
+    if (!read(_bgr_buffer))
+        return false;
+    cv::cvtColor(_bgr_buffer, frame, cv::COLOR_BGR2YUV_I420);
+    return true;
+}
+
+bool FrameSink::write_i420(const cv::Mat& frame)
+{
+    cv::cvtColor(frame, _bgr_buffer, cv::COLOR_YUV2BGR_I420);
+    return write(_bgr_buffer);
+}
+
+VideoCaptureSource::VideoCaptureSource(const std::string& url) : _capture(url)
+{
+    if (_capture.isOpened()) {
+        _width = _capture.get(cv::CAP_PROP_FRAME_WIDTH);
+        _height = _capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+        _fps = _capture.get(cv::CAP_PROP_FPS); // video frame rate
+        _total_frames = _capture.get(cv::CAP_PROP_FRAME_COUNT); // total number of frames
+    }
+}
+
+VideoWriterSink::VideoWriterSink(const std::string& url, int width, int height, double fps) : _writer(url, cv::VideoWriter::fourcc('a', 'v', 'c', '1'), fps, cv::Size(width, height)) {}
+
+void scale_frame(const cv::Mat& src, cv::Mat& dst, const cv::Size& size, bool planar)
+{
+    if (!planar) {
+        cv::resize(src, dst, size, 0., 0., cv::INTER_AREA);
+        return;
+    }
+
+    int width = src.cols, height = src.rows * 2 / 3;
+    dst.create(size.height * 3 / 2, size.width, CV_8UC1);
+    // Y, then the U and V planes (half size each) stored back to back
+    cv::Mat dst_y = dst.rowRange(0, size.height);
+    cv::resize(src.rowRange(0, height), dst_y, size, 0., 0., cv::INTER_AREA);
+    const unsigned char* src_chroma = src.ptr(height);
+    unsigned char* dst_chroma = dst.ptr(size.height);
+    for (int plane = 0; plane < 2; plane++) {
+        cv::Mat src_plane(height / 2, width / 2, CV_8UC1, const_cast<unsigned char*>(src_chroma) + plane * (width / 2) * (height / 2));
+        cv::Mat dst_plane(size.height / 2, size.width / 2, CV_8UC1, dst_chroma + plane * (size.width / 2) * (size.height / 2));
+        cv::resize(src_plane, dst_plane, dst_plane.size(), 0., 0., cv::INTER_AREA);
+    }
+}
+
+std::unique_ptr<FrameSource> open_frame_source(const StreamerConfiguration& config)
+{
+    if (config.input_format == "bgr24") {
+        return std::make_unique<RawFrameSource>(config.input_video_url, RawFrameFormat::BGR24, config.raw_frame_width, config.raw_frame_height, config.raw_fps);
+    }
+    else if (config.input_format == "y4m") {
+        return std::make_unique<RawFrameSource>(config.input_video_url, RawFrameFormat::Y4M, config.raw_frame_width, config.raw_frame_height, config.raw_fps);
+    }
+    else if (config.input_format != "file") {
+        std::cerr << "Unknown input format '" << config.input_format << "'. Falling back to 'file'." << std::endl;
+    }
+    return std::make_unique<VideoCaptureSource>(config.input_video_url);
+}
+
+std::unique_ptr<FrameSink> open_frame_sink(const StreamerConfiguration& config, int width, int height, double fps)
+{
+    if (config.output_format == "bgr24") {
+        return std::make_unique<RawFrameSink>(config.output_video_url, RawFrameFormat::BGR24, width, height, fps);
+    }
+    else if (config.output_format == "y4m") {
+        return std::make_unique<RawFrameSink>(config.output_video_url, RawFrameFormat::Y4M, width, height, fps);
+    }
+    else if (config.output_format != "file") {
+        std::cerr << "Unknown output format '" << config.output_format << "'. Falling back to 'file'." << std::endl;
+    }
+    return std::make_unique<VideoWriterSink>(config.output_video_url, width, height, fps);
+}
@@ -0,0 +1,94 @@
+#ifndef VIDEO_IO_FRAME_IO_HPP
+#define VIDEO_IO_FRAME_IO_HPP
+
+#include <utils/utils.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Source of BGR frames for the streamer (decoded video file, raw pipe, ...)
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    virtual bool is_opened() const = 0;
+    // Reads the next frame as CV_8UC3 BGR. The storage of frame is reused if it already has the right geometry.
+    virtual bool read(cv::Mat& frame) = 0;
+    // Reads the next frame as I420 planes (CV_8UC1, height * 3 / 2 rows). Sources that decode to BGR convert here;
+    // YUV sources override it and skip the conversion.
+    virtual bool read_i420(cv::Mat& frame);
+    virtual void release() = 0;
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    double fps() const { return _fps; }
+    // 0 if unknown (e.g. pipes)
+    std::size_t total_frames() const { return _total_frames; }
+
+protected:
+    cv::Mat _bgr_buffer;
+    int _width = 0;
+    int _height = 0;
+    double _fps = 0.;
+    std::size_t _total_frames = 0;
+};
+
+// Consumer of processed BGR frames (encoded video file, raw pipe, ...)
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    virtual bool is_opened() const = 0;
+    virtual bool write(const cv::Mat& frame) = 0;
+    // Writes a frame stored as I420 planes; converts to BGR unless the sink takes YUV
+    virtual bool write_i420(const cv::Mat& frame);
+    // Flushes and closes the output (writes the trailer for encoded files)
+    virtual void release() = 0;
+
+protected:
+    cv::Mat _bgr_buffer;
+};
+
+// Decode with cv::VideoCapture
+class VideoCaptureSource : public FrameSource {
+public:
+    VideoCaptureSource(const std::string& url);
+
+    bool is_opened() const override { return _capture.isOpened(); }
+    bool read(cv::Mat& frame) override { return _capture.read(frame); }
+    void release() override { _capture.release(); }
+
+protected:
+    cv::VideoCapture _capture;
+};
+
+// Encode with cv::VideoWriter (H.264)
+class VideoWriterSink : public FrameSink {
+public:
+    VideoWriterSink(const std::string& url, int width, int height, double fps);
+
+    bool is_opened() const override { return _writer.isOpened(); }
+    bool write(const cv::Mat& frame) override
+    {
+        _writer.write(frame);
+        return true;
+    }
+    void release() override { _writer.release(); }
+
+protected:
+    cv::VideoWriter _writer;
+};
+
+// Downscales a BGR or I420 (planar) frame to size (area interpolation, each plane separately for I420).
+// dst keeps its storage if it already has the right geometry.
+void scale_frame(const cv::Mat& src, cv::Mat& dst, const cv::Size& size, bool planar);
+
+// Opens the input/output selected by io.input_format/io.output_format in the configuration
+std::unique_ptr<FrameSource> open_frame_source(const StreamerConfiguration& config);
+std::unique_ptr<FrameSink> open_frame_sink(const StreamerConfiguration& config, int width, int height, double fps);
+
+#endif
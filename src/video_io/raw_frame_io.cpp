@@ -0,0 +1,251 @@
+#include "raw_frame_io.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+    // Large stdio buffers: a 4K BGR frame is ~25MB, pipes are much faster with few big reads/writes
+    constexpr std::size_t pipe_buffer_size = 1 << 22;
+
+    // Reads one '\n'-terminated line (without the '\n'). Returns false on EOF.
+    bool read_line(FILE* file, std::string& line, std::size_t max_length = 1024)
+    {
+        line.clear();
+        int ch;
+        while ((ch = std::fgetc(file)) != EOF) {
+            if (ch == '\n')
+                return true;
+            if (line.size() >= max_length)
+                return false;
+            line.push_back(static_cast<char>(ch));
+        }
+        return false;
+    }
+
+    bool read_all(FILE* file, unsigned char* data, std::size_t size)
+    {
+        return std::fread(data, 1, size, file) == size;
+    }
+
+    bool write_all(FILE* file, const cv::Mat& image)
+    {
+        if (image.isContinuous())
+            return std::fwrite(image.data, 1, image.total() * image.elemSize(), file) == image.total() * image.elemSize();
+        for (int r = 0; r < image.rows; r++) {
+            if (std::fwrite(image.ptr(r), 1, image.cols * image.elemSize(), file) != image.cols * image.elemSize())
+                return false;
+        }
+        return true;
+    }
+} // namespace
+
+RawFrameSource::RawFrameSource(const std::string& url, RawFrameFormat format, int width, int height, double fps) : _format(format)
+{
+    _width = width;
+    _height = height;
+    _fps = fps;
+    _total_frames = 0; // unknown for streams
+
+    if (url == "-") {
+        _file = stdin;
+        _owns_file = false;
+    }
+    else {
+        // Opening a FIFO blocks until the writer side is opened as well
+        _file = std::fopen(url.c_str(), "rb");
+        _owns_file = true;
+    }
+    if (_file == nullptr) {
+        std::cerr << "Could not open raw input: " << url << std::endl;
+        return;
+    }
+    std::setvbuf(_file, nullptr, _IOFBF, pipe_buffer_size);
+
+    if (_format == RawFrameFormat::Y4M && !_read_y4m_header()) {
+        release();
+    }
+}
+
+RawFrameSource::~RawFrameSource()
+{
+    release();
+}
+
+bool RawFrameSource::_read_y4m_header()
+{
+    std::string header;
+    if (!read_line(_file, header) || header.compare(0, 9, "YUV4MPEG2") != 0) {
+        std::cerr << "Raw input is not a YUV4MPEG2 stream" << std::endl;
+        return false;
+    }
+
+    std::stringstream ss(header.substr(9));
+    std::string token;
+    try {
+        while (ss >> token) {
+            switch (token[0]) {
+            case 'W':
+                _width = std::stoi(token.substr(1));
+                break;
+            case 'H':
+                _height = std::stoi(token.substr(1));
+                break;
+            case 'F': {
+                std::size_t colon = token.find(':');
+                if (colon != std::string::npos) {
+                    double num = std::stod(token.substr(1, colon - 1));
+                    double den = std::stod(token.substr(colon + 1));
+                    if (den > 0.)
+                        _fps = num / den;
+                }
+                break;
+            }
+            case 'C':
+                // 8-bit 4:2:0 variants only differ in chroma siting (C420p10 and the like have 16-bit samples)
+                if (token != "C420" && token != "C420jpeg" && token != "C420paldv" && token != "C420mpeg2") {
+                    std::cerr << "Unsupported Y4M colorspace " << token << " (only 8-bit 4:2:0 is supported)" << std::endl;
+                    return false;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << "Malformed YUV4MPEG2 header parameter " << token << std::endl;
+        return false;
+    }
+    // Odd sizes have rounded-up chroma planes, the I420 frames here assume exact halves
+    if (_width % 2 != 0 || _height % 2 != 0) {
+        std::cerr << "Unsupported Y4M frame size " << _width << "x" << _height << " (only even sizes are supported)" << std::endl;
+        return false;
+    }
+    return _width > 0 && _height > 0;
+}
+
+bool RawFrameSource::read(cv::Mat& frame)
+{
+    if (_file == nullptr)
+        return false;
+
+    frame.create(_height, _width, CV_8UC3);
+
+    if (_format == RawFrameFormat::BGR24) {
+        if (frame.isContinuous())
+            return read_all(_file, frame.data, frame.total() * frame.elemSize());
+        for (int r = 0; r < frame.rows; r++) {
+            if (!read_all(_file, frame.ptr(r), frame.cols * frame.elemSize()))
+                return false;
+        }
+        return true;
+    }
+
+    if (!_read_y4m_frame(_yuv_buffer))
+        return false;
+    cv::cvtColor(_yuv_buffer, frame, cv::COLOR_YUV2BGR_I420);
+    return true;
+}
+
+bool RawFrameSource::read_i420(cv::Mat& frame)
+{
+    if (_file == nullptr)
+        return false;
+    if (_format == RawFrameFormat::BGR24)
+        return FrameSource::read_i420(frame);
+    return _read_y4m_frame(frame);
+}
+
+bool RawFrameSource::_read_y4m_frame(cv::Mat& planes)
+{
+    // "FRAME[ params]\n" followed by the Y, U and V planes
+    std::string frame_header;
+    if (!read_line(_file, frame_header) || frame_header.compare(0, 5, "FRAME") != 0)
+        return false;
+    planes.create(_height * 3 / 2, _width, CV_8UC1);
+    return read_all(_file, planes.data, planes.total());
+}
+
+void RawFrameSource::release()
+{
+    if (_file != nullptr && _owns_file)
+        std::fclose(_file);
+    _file = nullptr;
+}
+
+RawFrameSink::RawFrameSink(const std::string& url, RawFrameFormat format, int width, int height, double fps) : _format(format), _width(width), _height(height)
+{
+    if (url == "-") {
+        // Frames get their own descriptor and fd 1 is pointed at stderr, so progress/log output
+        // written to std::cout anywhere in the program cannot corrupt the frame stream
+        int frame_fd = dup(STDOUT_FILENO);
+        if (frame_fd >= 0) {
+            std::fflush(stdout);
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+            _file = fdopen(frame_fd, "wb");
+        }
+    }
+    else {
+        _file = std::fopen(url.c_str(), "wb");
+    }
+    if (_file == nullptr) {
+        std::cerr << "Could not open raw output: " << url << std::endl;
+        return;
+    }
+    std::setvbuf(_file, nullptr, _IOFBF, pipe_buffer_size);
+
+    if (_format == RawFrameFormat::Y4M) {
+        // Frame rate as a rational, exact for integer and NTSC (x/1001) rates
+        long num = std::lround(fps * 1001.), den = 1001;
+        if (num % 1001 == 0) {
+            num /= 1001;
+            den = 1;
+        }
+        std::fprintf(_file, "YUV4MPEG2 W%d H%d F%ld:%ld Ip A1:1 C420jpeg\n", _width, _height, num, den);
+    }
+}
+
+RawFrameSink::~RawFrameSink()
+{
+    release();
+}
+
+bool RawFrameSink::write(const cv::Mat& frame)
+{
+    if (_file == nullptr)
+        return false;
+
+    if (_format == RawFrameFormat::BGR24)
+        return write_all(_file, frame);
+
+    cv::cvtColor(frame, _yuv_buffer, cv::COLOR_BGR2YUV_I420);
+    return _write_y4m_frame(_yuv_buffer);
+}
+
+bool RawFrameSink::write_i420(const cv::Mat& frame)
+{
+    if (_file == nullptr)
+        return false;
+    if (_format == RawFrameFormat::BGR24)
+        return FrameSink::write_i420(frame);
+    return _write_y4m_frame(frame);
+}
+
+bool RawFrameSink::_write_y4m_frame(const cv::Mat& planes)
+{
+    if (std::fputs("FRAME\n", _file) == EOF)
+        return false;
+    return write_all(_file, planes);
+}
+
+void RawFrameSink::release()
+{
+    if (_file != nullptr)
+        std::fclose(_file);
+    _file = nullptr;
+}
@@ -0,0 +1,57 @@
+#ifndef VIDEO_IO_RAW_FRAME_IO_HPP
+#define VIDEO_IO_RAW_FRAME_IO_HPP
+
+#include <video_io/frame_io.hpp>
+
+#include <cstdio>
+#include <string>
+
+// Uncompressed frame formats that can be exchanged with e.g. ffmpeg over pipes
+enum class RawFrameFormat {
+    BGR24, // packed BGR, no header (ffmpeg -f rawvideo -pix_fmt bgr24)
+    Y4M // YUV4MPEG2 stream with 4:2:0 planes (ffmpeg -f yuv4mpegpipe)
+};
+
+// Reads raw frames from stdin ("-"), a named FIFO or a regular file. BGR24 needs the geometry from the configuration;
+// Y4M takes it from the stream header.
+class RawFrameSource : public FrameSource {
+public:
+    RawFrameSource(const std::string& url, RawFrameFormat format, int width, int height, double fps);
+    ~RawFrameSource();
+
+    bool is_opened() const override { return _file != nullptr; }
+    bool read(cv::Mat& frame) override;
+    bool read_i420(cv::Mat& frame) override;
+    void release() override;
+
+protected:
+    bool _read_y4m_header();
+    bool _read_y4m_frame(cv::Mat& planes);
+
+    FILE* _file = nullptr;
+    bool _owns_file = false;
+    RawFrameFormat _format;
+    cv::Mat _yuv_buffer; // I420 staging buffer for Y4M
+};
+
+// Writes raw frames to stdout ("-"), a named FIFO or a regular file
+class RawFrameSink : public FrameSink {
+public:
+    RawFrameSink(const std::string& url, RawFrameFormat format, int width, int height, double fps);
+    ~RawFrameSink();
+
+    bool is_opened() const override { return _file != nullptr; }
+    bool write(const cv::Mat& frame) override;
+    bool write_i420(const cv::Mat& frame) override;
+    void release() override;
+
+protected:
+    bool _write_y4m_frame(const cv::Mat& planes);
+
+    FILE* _file = nullptr;
+    RawFrameFormat _format;
+    int _width, _height;
+    cv::Mat _yuv_buffer;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "smart_render.hpp"
+
+#include <utils/subprocess.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+std::string probe_video_codec(const std::string& url)
+{
+    std::vector<std::string> lines;
+    if (!run_tool({"ffprobe", "-v", "error", "-select_streams", "v:0", "-show_entries", "stream=codec_name", "-of", "csv=p=0", url}, lines) || lines.empty())
+        return "";
+    return lines[0];
+}
+
+std::vector<CutPoint> probe_cut_points(const std::string& url, std::size_t& total_frames)
+{
+    std::vector<CutPoint> cuts;
+    total_frames = 0;
+    std::vector<std::string> lines;
+    // Packets only, in decode order; nothing is decoded, which makes this a fast pass over the file
+    if (!run_tool({"ffprobe", "-v", "error", "-select_streams", "v:0", "-show_entries", "packet=pts_time,flags", "-of", "csv=p=0", url}, lines))
+        return cuts;
+
+    std::vector<double> pts;
+    std::vector<char> key;
+    for (const auto& line : lines) {
+        std::size_t comma = line.find(',');
+        if (line.empty() || comma == std::string::npos)
+            continue;
+        // Without presentation times the display order is unknown
+        if (line.compare(0, comma, "N/A") == 0)
+            return cuts;
+        try {
+            pts.push_back(std::stod(line.substr(0, comma)));
+        }
+        catch (const std::exception&) {
+            return cuts;
+        }
+        key.push_back(line.find('K', comma) != std::string::npos);
+    }
+    std::size_t n = pts.size();
+    if (n == 0)
+        return cuts;
+    total_frames = n;
+
+    // Latest presentation time before each packet and earliest one after it (decode order)
+    std::vector<double> before(n, -std::numeric_limits<double>::infinity()), after(n, std::numeric_limits<double>::infinity());
+    for (std::size_t i = 1; i < n; i++)
+        before[i] = std::max(before[i - 1], pts[i - 1]);
+    for (std::size_t i = n - 1; i-- > 0;)
+        after[i] = std::min(after[i + 1], pts[i + 1]);
+
+    // A keyframe is a clean cut if everything decoded before it is also displayed before it and everything decoded after
+    // it is displayed after it. That rules out open GOPs (leading pictures that refer to the previous GOP), and the
+    // frames before the cut are the same in decode and presentation order, so its frame index is its packet index.
+    cuts.push_back({0, 0.});
+    for (std::size_t i = 1; i < n; i++) {
+        if (key[i] && before[i] < pts[i] && after[i] > pts[i])
+            cuts.push_back({i, (before[i] + pts[i]) / 2.});
+    }
+    return cuts;
+}
+
+std::vector<SmartRenderPiece> plan_smart_render(const std::vector<std::size_t>& keyframes, const std::vector<FrameRange>& overlays, std::size_t total_frames)
+{
+    std::vector<SmartRenderPiece> pieces;
+    std::size_t next_overlay = 0;
+    for (std::size_t k = 0; k < keyframes.size() && keyframes[k] < total_frames; k++) {
+        FrameRange gop{keyframes[k], (k + 1 < keyframes.size()) ? std::min(keyframes[k + 1], total_frames) : total_frames};
+        if (gop.end <= gop.begin)
+            continue;
+        // Overlay ranges are sorted and disjoint
+        while (next_overlay < overlays.size() && overlays[next_overlay].end <= gop.begin)
+            next_overlay++;
+        bool render = next_overlay < overlays.size() && overlays[next_overlay].begin < gop.end;
+
+        // Consecutive GOPs of the same kind form one piece
+        if (!pieces.empty() && pieces.back().render == render && pieces.back().frames.end == gop.begin)
+            pieces.back().frames.end = gop.end;
+        else
+            pieces.push_back({gop, render});
+    }
+    return pieces;
+}
+
+std::string piece_url(const std::string& prefix, std::size_t k)
+{
+    return prefix + std::to_string(k) + ".mp4";
+}
+
+namespace {
+    // Number of packets of the first video stream, -1 if the file cannot be read
+    long count_packets(const std::string& url)
+    {
+        std::vector<std::string> lines;
+        if (!run_tool({"ffprobe", "-v", "error", "-select_streams", "v:0", "-count_packets", "-show_entries", "stream=nb_read_packets", "-of", "csv=p=0", url}, lines) || lines.empty())
+            return -1;
+        try {
+            return std::stol(lines[0]);
+        }
+        catch (const std::exception&) {
+            return -1;
+        }
+    }
+
+    // Quoted for the list of ffmpeg's concat demuxer: a ' inside the path ends the quote, is escaped and starts a new one
+    std::string concat_quote(const std::string& path)
+    {
+        std::string quoted = "'";
+        for (char c : path)
+            quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+        return quoted + "'";
+    }
+} // namespace
+
+bool split_into_pieces(const std::string& url, const std::vector<SmartRenderPiece>& pieces, const std::vector<CutPoint>& cuts, const std::string& prefix)
+{
+    // The segment muxer cuts at the first keyframe whose presentation time is at or after each listed time. The times
+    // lie between a clean cut and the frame displayed before it, and are compared against the input timestamps as
+    // they are (-copyts).
+    std::ostringstream times;
+    times << std::setprecision(17);
+    for (std::size_t k = 1; k < pieces.size(); k++) {
+        auto cut = std::find_if(cuts.begin(), cuts.end(), [&](const CutPoint& c) { return c.frame == pieces[k].frames.begin; });
+        if (cut == cuts.end()) {
+            std::cerr << "Piece " << k << " does not start at a clean cut" << std::endl;
+            return false;
+        }
+        times << (k > 1 ? "," : "") << cut->time;
+    }
+    std::vector<std::string> args{"ffmpeg", "-y", "-loglevel", "error", "-copyts", "-i", url, "-map", "0:v:0", "-c", "copy", "-f", "segment", "-reset_timestamps", "1"};
+    if (pieces.size() > 1) {
+        args.push_back("-segment_times");
+        args.push_back(times.str());
+    }
+    args.push_back(prefix + "%d.mp4");
+    if (!run_tool(args)) {
+        std::cerr << "Could not split " << url << " with ffmpeg" << std::endl;
+        return false;
+    }
+
+    // The copied pieces have to line up with the planned frame ranges exactly, or frames would be duplicated or
+    // dropped at the seams
+    for (std::size_t k = 0; k < pieces.size(); k++) {
+        long frames = count_packets(piece_url(prefix, k));
+        if (frames != static_cast<long>(pieces[k].frames.end - pieces[k].frames.begin)) {
+            std::cerr << "Piece " << k << " of " << url << " has " << frames << " frames instead of " << pieces[k].frames.end - pieces[k].frames.begin << std::endl;
+            return false;
+        }
+    }
+    if (std::filesystem::exists(piece_url(prefix, pieces.size()))) {
+        std::cerr << "ffmpeg cut " << url << " into more pieces than planned" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool same_codec_parameters(const std::vector<std::string>& urls)
+{
+    std::string reference;
+    for (const auto& url : urls) {
+        std::vector<std::string> lines;
+        if (!run_tool({"ffprobe", "-v", "error", "-select_streams", "v:0", "-show_entries", "stream=codec_name,profile,width,height,pix_fmt", "-of", "csv=p=0", url}, lines) || lines.empty())
+            return false;
+        if (reference.empty())
+            reference = lines[0];
+        else if (lines[0] != reference)
+            return false;
+    }
+    return !reference.empty();
+}
+
+bool concat_h264(const std::vector<std::string>& urls, const std::string& output_url)
+{
+    // Annex B in MPEG-TS keeps the SPS/PPS of every file in-band, where the MP4 of a plain concat would keep only the
+    // avcC of the first one
+    std::vector<std::string> parts;
+    bool converted = true;
+    for (std::size_t k = 0; k < urls.size() && converted; k++) {
+        parts.push_back(output_url + ".part" + std::to_string(k) + ".ts");
+        converted = run_tool({"ffmpeg", "-y", "-loglevel", "error", "-i", urls[k], "-map", "0:v:0", "-c", "copy", "-bsf:v", "h264_mp4toannexb", "-f", "mpegts", parts.back()});
+    }
+
+    bool joined = false;
+    std::string list_url = output_url + ".segments.txt";
+    if (converted) {
+        {
+            std::ofstream list(list_url);
+            for (const auto& part : parts)
+                list << "file " << concat_quote(std::filesystem::absolute(part).string()) << "\n";
+        }
+        joined = run_tool({"ffmpeg", "-y", "-loglevel", "error", "-f", "concat", "-safe", "0", "-i", list_url, "-c", "copy", output_url});
+        std::filesystem::remove(list_url);
+    }
+    for (const auto& part : parts)
+        std::filesystem::remove(part);
+    return joined;
+}
@@ -0,0 +1,49 @@
+#ifndef VIDEO_IO_SMART_RENDER_HPP
+#define VIDEO_IO_SMART_RENDER_HPP
+
+#include <utils/timeline.hpp>
+
+#include <string>
+#include <vector>
+
+// Smart render: the output is assembled from GOP-aligned pieces of the input. Pieces without any overlay are
+// packet-copied, only pieces with an overlay on screen are decoded, rendered and re-encoded.
+// Everything on the container level goes through the ffmpeg/ffprobe command line tools.
+
+struct SmartRenderPiece {
+    FrameRange frames;
+    bool render = false;
+};
+
+// Codec name of the first video stream ("h264", "hevc", ...), empty if ffprobe is not available
+std::string probe_video_codec(const std::string& url);
+// Place where the input can be cut without breaking a GOP: index (presentation order) of a keyframe that starts a
+// closed GOP, and a presentation time between it and the frame displayed before it
+struct CutPoint {
+    std::size_t frame = 0;
+    double time = 0.;
+};
+
+// Clean cut points of the first video stream, found from its packets (IDR or closed-GOP keyframes; open-GOP I-frames
+// are skipped). Frame 0 is always the first one. total_frames gets the number of packets. Empty if ffprobe is not
+// available.
+std::vector<CutPoint> probe_cut_points(const std::string& url, std::size_t& total_frames);
+
+// Cuts [0, total_frames) at keyframes (the frames of the cut points) into alternating copy/render pieces. A GOP is
+// rendered if any of its frames is inside one of the overlay ranges.
+std::vector<SmartRenderPiece> plan_smart_render(const std::vector<std::size_t>& keyframes, const std::vector<FrameRange>& overlays, std::size_t total_frames);
+
+// File that split_into_pieces writes piece k to
+std::string piece_url(const std::string& prefix, std::size_t k);
+// Stream-copies the video of url into one file per piece, cutting at the first frame of each piece (a cut point).
+// Fails unless every piece file has exactly the planned frames.
+bool split_into_pieces(const std::string& url, const std::vector<SmartRenderPiece>& pieces, const std::vector<CutPoint>& cuts, const std::string& prefix);
+
+// Whether the first video streams of all files have the same codec, profile, size and pixel format, so that they can
+// be played back as one stream
+bool same_codec_parameters(const std::vector<std::string>& urls);
+// Stream-copies H.264 files one after the other into output_url, through an MPEG-TS (Annex B) intermediate so that
+// every file keeps its own SPS/PPS in-band
+bool concat_h264(const std::vector<std::string>& urls, const std::string& output_url);
+
+#endif